@@ -3,6 +3,10 @@ ExternalProject_Add(
         chess-core-external
         URL https://github.com/leonkacowicz/chess-core/archive/refs/heads/main.zip
         PREFIX ${CMAKE_BINARY_DIR}/chess-core-external
+        # the board and move generator get the same instruction set, LTO and PGO flags as the engine. The
+        # Release flags follow the ones chess-core adds itself, so they cap its instruction set at ENGINE_ARCH.
+        CMAKE_ARGS -DCMAKE_BUILD_TYPE=${CMAKE_BUILD_TYPE} "-DCMAKE_CXX_FLAGS=${ENGINE_OPT_FLAGS}"
+                   "-DCMAKE_CXX_FLAGS_RELEASE=-O3 -DNDEBUG ${ENGINE_ARCH_OFF_FLAGS}"
         INSTALL_COMMAND ""
         LOG_DOWNLOAD ON
         LOG_CONFIGURE ON)
@@ -0,0 +1,17 @@
+include(ExternalProject)
+ExternalProject_Add(
+        fathom-external
+        URL https://github.com/jdart1/Fathom/archive/refs/heads/master.zip
+        PREFIX ${CMAKE_BINARY_DIR}/fathom-external
+        CONFIGURE_COMMAND ""
+        BUILD_COMMAND ""
+        INSTALL_COMMAND ""
+        LOG_DOWNLOAD ON)
+
+# Fathom is a single C file, so it is compiled here rather than with its own build
+ExternalProject_Get_Property(fathom-external source_dir)
+set(FATHOM_SOURCE_DIR "${source_dir}/src")
+set_source_files_properties("${FATHOM_SOURCE_DIR}/tbprobe.c" PROPERTIES GENERATED TRUE)
+add_library(libfathom STATIC "${FATHOM_SOURCE_DIR}/tbprobe.c")
+add_dependencies(libfathom fathom-external)
+include_directories("${FATHOM_SOURCE_DIR}")
@@ -0,0 +1,75 @@
+#!/bin/sh
+# Builds chessengine once per instruction set with LTO and, where this machine can run the build, a two-stage
+# PGO: the instrumented binary runs the bench positions and the final build is optimized with that profile.
+# The results go to dist/ together with the launcher, which starts the best variant for the CPU it runs on:
+#   dist/chessengine             launcher
+#   dist/chessengine-<arch>      one build per ARCHS entry
+# usage: scripts/build_variants.sh [bench depth]
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+DIST="$ROOT/dist"
+ARCHS="x86-64 popcnt bmi2 avx2"
+BENCH_DEPTH=${1:-6}
+JOBS=$(nproc)
+
+cpu_has() {
+    case "$1" in
+        x86-64) return 0 ;;
+        popcnt) grep -qw popcnt /proc/cpuinfo ;;
+        bmi2) grep -qw bmi2 /proc/cpuinfo ;;
+        avx2) grep -qw avx2 /proc/cpuinfo && grep -qw bmi2 /proc/cpuinfo ;;
+    esac
+}
+
+# checks the disassembly, chess-core's code included, for instructions above the variant's instruction set:
+# AVX registers below avx2, BMI1/BMI2 below bmi2 and popcnt in the baseline build
+check_instructions() {
+    bmi='andn|bextr|blsi|blsmsk|blsr|bzhi|mulx|pdep|pext|rorx|sarx|shlx|shrx'
+    case "$2" in
+        x86-64) pattern="%ymm|:[[:space:]]+(popcnt|$bmi)[[:space:]]" ;;
+        popcnt) pattern="%ymm|:[[:space:]]+($bmi)[[:space:]]" ;;
+        bmi2) pattern="%ymm" ;;
+        *) return 0 ;;
+    esac
+    if objdump -d --no-show-raw-insn "$1" | grep -Eq "$pattern"; then
+        echo "$1 has instructions beyond $2" >&2
+        exit 1
+    fi
+}
+
+configure() {
+    cmake -S "$ROOT" -B "$1" -DCMAKE_BUILD_TYPE=Release -DENGINE_ARCH="$2" -DENGINE_LTO=ON -DENGINE_PGO="$3" \
+          -DENGINE_PGO_DIR="$1/pgo"
+}
+
+mkdir -p "$DIST"
+for arch in $ARCHS; do
+    build="$ROOT/build-$arch"
+    if cpu_has "$arch"; then
+        rm -rf "$build/pgo"
+        configure "$build" "$arch" GENERATE
+        cmake --build "$build" --target chessengine -j"$JOBS"
+        "$build/src/engine/chessengine" bench "$BENCH_DEPTH"
+        if command -v llvm-profdata > /dev/null && ls "$build"/pgo/*.profraw > /dev/null 2>&1; then
+            llvm-profdata merge -output="$build/pgo/engine.profdata" "$build"/pgo/*.profraw
+        fi
+        configure "$build" "$arch" USE
+    else
+        echo "this CPU can't run the $arch build, building it without PGO"
+        configure "$build" "$arch" OFF
+    fi
+    cmake --build "$build" --target chessengine -j"$JOBS"
+    check_instructions "$build/src/engine/chessengine" "$arch"
+    cp "$build/src/engine/chessengine" "$DIST/chessengine-$arch"
+done
+
+cmake --build "$ROOT/build-x86-64" --target chessengine-launcher -j"$JOBS"
+cp "$ROOT/build-x86-64/src/launcher/chessengine-launcher" "$DIST/chessengine"
+
+for arch in $ARCHS; do
+    if cpu_has "$arch"; then
+        printf '%-8s ' "$arch"
+        "$DIST/chessengine-$arch" bench "$BENCH_DEPTH" | tail -n 1
+    fi
+done
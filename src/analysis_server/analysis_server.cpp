@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <chess/move_gen.h>
+#include <chess/fen.h>
+#include <chess/uci/uci.h>
+#include <chess/engine/static_evaluator.h>
+
+#include "analysis_server.h"
+
+using namespace chess::core;
+
+static constexpr size_t MAX_LINE = 1 << 16;
+// output a client leaves unread beyond this closes its session
+static constexpr size_t MAX_OUTPUT = 1 << 20;
+
+session::session(int fd) : fd(fd) {
+}
+
+session::~session() {
+    close(fd);
+}
+
+void session::send(const std::string& line) {
+    output += line;
+    output += '\n';
+    flush();
+}
+
+bool session::flush() {
+    while (!output.empty()) {
+        ssize_t n = ::send(fd, output.data(), output.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if (n <= 0) {
+            // the client went away, the connection thread notices on its next read
+            output.clear();
+            return false;
+        }
+        output.erase(0, n);
+    }
+    return true;
+}
+
+// the tighter of a requested limit and the server's, where 0 stands for no limit
+template<typename T>
+static T tighter(T requested, T limit) {
+    if (requested == T{}) return limit;
+    if (limit == T{}) return requested;
+    return std::min(requested, limit);
+}
+
+static bool do_long_move(game& g, const std::string& long_move) {
+    for (move m : move_gen(g.states.back().b).generate()) {
+        if (to_long_move(m) == long_move) {
+            g.do_move(m);
+            return true;
+        }
+    }
+    return false;
+}
+
+// a go limit; stoll and friends throw on garbage but would take a negative number
+static long long parse_limit(const std::string& value) {
+    long long limit = std::stoll(value);
+    if (limit < 0) throw std::invalid_argument("negative limit " + value);
+    return limit;
+}
+
+static bool has_both_kings(const board& b) {
+    for (color c : {WHITE, BLACK}) {
+        if (__builtin_popcountll(uint64_t(b.piece_of_type[KING] & b.piece_of_color[c])) != 1) return false;
+    }
+    return true;
+}
+
+static std::string format_score(int val) {
+    int mate = MATE - std::abs(val);
+    if (mate < 30) return val < 0 ? "mate -" + std::to_string(mate) : "mate " + std::to_string(mate);
+    return "cp " + std::to_string(val);
+}
+
+analysis_server::analysis_server(server_options options)
+        : options(std::move(options)), start(std::chrono::steady_clock::now()) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (this->options.socket_path.size() >= sizeof(address.sun_path))
+        throw std::runtime_error("socket path too long: " + this->options.socket_path);
+    std::strcpy(address.sun_path, this->options.socket_path.c_str());
+
+    // a socket file left behind by a server that was killed would make bind fail; anything else at the path is
+    // most likely a mistyped argument and stays untouched
+    struct stat st{};
+    if (lstat(address.sun_path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode))
+            throw std::runtime_error(this->options.socket_path + " exists and is not a socket");
+        unlink(address.sun_path);
+    }
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) throw std::system_error(errno, std::generic_category(), "socket");
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listen_fd, 64) < 0
+        || lstat(address.sun_path, &st) < 0) {
+        int error = errno;
+        close(listen_fd);
+        throw std::system_error(error, std::generic_category(), "listening on " + this->options.socket_path);
+    }
+    socket_device = st.st_dev;
+    socket_inode = st.st_ino;
+    if (pipe2(wake_fds, O_NONBLOCK | O_CLOEXEC) < 0) {
+        int error = errno;
+        close(listen_fd);
+        throw std::system_error(error, std::generic_category(), "pipe");
+    }
+
+    if (this->options.shared_hash) shared_tt = std::make_shared<tt_storage>(std::max(this->options.hash, size_t(1)));
+    for (int i = 0; i < std::max(this->options.workers, 1); i++)
+        workers.emplace_back(&analysis_server::run_worker, this);
+}
+
+analysis_server::~analysis_server() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        closing = true;
+    }
+    queue_changed.notify_all();
+    while (!sessions.empty()) close_session(*sessions.begin()->second);
+    for (auto& t : workers) t.join();
+    close(wake_fds[0]);
+    close(wake_fds[1]);
+    close(listen_fd);
+    // only the server's own socket: the path may have been replaced meanwhile
+    struct stat st{};
+    if (lstat(options.socket_path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode) && st.st_dev == socket_device
+        && st.st_ino == socket_inode)
+        unlink(options.socket_path.c_str());
+}
+
+void analysis_server::run(const std::atomic<bool>& stopping) {
+    using namespace std::chrono_literals;
+    auto last_report = std::chrono::steady_clock::now();
+    uint64_t reported_analyses = 0;
+    while (!stopping) {
+        std::vector<pollfd> fds{{listen_fd, POLLIN, 0}, {wake_fds[0], POLLIN, 0}};
+        for (auto& [fd, s] : sessions) {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            fds.push_back({fd, short(s->output.empty() ? POLLIN : POLLIN | POLLOUT), 0});
+        }
+        if (poll(fds.data(), fds.size(), 1000) < 0) {
+            if (errno == EINTR) continue;
+            throw std::system_error(errno, std::generic_category(), "poll");
+        }
+        if (fds[1].revents & POLLIN) {
+            char buffer[64];
+            while (read(wake_fds[0], buffer, sizeof(buffer)) > 0);
+        }
+        for (size_t i = 2; i < fds.size(); i++) {
+            if (fds[i].revents == 0) continue;
+            auto it = sessions.find(fds[i].fd);
+            if (it == sessions.end()) continue;
+            std::shared_ptr<session> s = it->second;
+            // only read when there is something to read, the descriptor blocks
+            bool open = !(fds[i].revents & (POLLIN | POLLHUP | POLLERR)) || read_session(*s);
+            if (open) {
+                std::lock_guard<std::mutex> lock(s->mutex);
+                open = s->flush() && s->output.size() < MAX_OUTPUT;
+            }
+            if (!open) close_session(*s);
+        }
+        if (fds[0].revents & POLLIN) accept_session();
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_report >= 10s && analyses != reported_analyses) {
+            std::cout << report() << std::endl;
+            last_report = now;
+            reported_analyses = analyses;
+        }
+    }
+}
+
+void analysis_server::accept_session() {
+    int fd = accept(listen_fd, nullptr, nullptr);
+    if (fd < 0) return;
+    sessions[fd] = std::make_shared<session>(fd);
+}
+
+bool analysis_server::read_session(session& s) {
+    char buffer[4096];
+    ssize_t n = recv(s.fd, buffer, sizeof(buffer), 0);
+    if (n < 0 && errno == EINTR) return true;
+    if (n <= 0) return false;
+    s.input.append(buffer, n);
+    size_t end;
+    while ((end = s.input.find('\n')) != std::string::npos) {
+        std::string line = s.input.substr(0, end);
+        s.input.erase(0, end + 1);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line == "quit") return false;
+        try {
+            handle_command(s, line);
+        } catch (const std::exception& e) {
+            // e.g. a number or a FEN that doesn't parse: the session gets told, the server carries on
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.send(std::string("error ") + e.what());
+        }
+    }
+    return s.input.size() < MAX_LINE;
+}
+
+void analysis_server::handle_command(session& s, const std::string& line) {
+    std::istringstream in(line);
+    std::vector<std::string> tokens;
+    for (std::string token; in >> token;) tokens.push_back(token);
+    if (tokens.empty()) return;
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    if (tokens[0] == "isready") {
+        s.send("readyok");
+    } else if (tokens[0] == "stats") {
+        s.send(report());
+    } else if (tokens[0] == "stop") {
+        s.stop_requested = true;
+        if (s.searching) s.searching->stop();
+    } else if (tokens[0] == "position") {
+        if (tokens.size() < 2 || (tokens[1] != "startpos" && (tokens[1] != "fen" || tokens.size() < 3)))
+            return s.send("error expected position startpos|fen <fen> [moves ...]");
+        chess::uci::cmd_position position = chess::uci::parse_cmd_position(tokens);
+        game g = position.initial_position == "startpos" ? game() : game(fen::board_from_fen(position.initial_position));
+        if (!has_both_kings(g.states.back().b)) return s.send("error invalid fen " + position.initial_position);
+        for (const auto& long_move : position.moves) {
+            if (!do_long_move(g, long_move)) return s.send("error illegal move " + long_move);
+        }
+        s.g = g;
+    } else if (tokens[0] == "go") {
+        if (s.busy) return s.send("error analysis running");
+        if (move_gen(s.g.states.back().b).generate().empty()) return s.send("bestmove (none)");
+        analysis a{nullptr, s.g, options.time, options.nodes, options.depth};
+        for (size_t i = 1; i + 1 < tokens.size(); i += 2) {
+            if (tokens[i] == "movetime") a.time = tighter(std::chrono::milliseconds(parse_limit(tokens[i + 1])), options.time);
+            else if (tokens[i] == "nodes") a.nodes = tighter<uint64_t>(parse_limit(tokens[i + 1]), options.nodes);
+            else if (tokens[i] == "depth") a.depth = tighter(int(std::min<long long>(parse_limit(tokens[i + 1]), MAX_PLY)), options.depth);
+        }
+        a.owner = sessions.at(s.fd);
+        s.busy = true;
+        s.stop_requested = false;
+        {
+            std::lock_guard<std::mutex> queue_lock(queue_mutex);
+            queue.push_back(std::move(a));
+        }
+        queue_changed.notify_one();
+    } else {
+        s.send("error unknown command " + tokens[0]);
+    }
+}
+
+void analysis_server::wake() {
+    // the pipe is non-blocking: when it is full the poll thread is woken already
+    char byte = 0;
+    ssize_t ignored = write(wake_fds[1], &byte, 1);
+    (void) ignored;
+}
+
+void analysis_server::close_session(session& s) {
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.closed = true;
+        if (s.searching) s.searching->stop();
+    }
+    sessions.erase(s.fd);
+}
+
+bool analysis_server::next_analysis(analysis& a) {
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    queue_changed.wait(lock, [this] { return closing || !queue.empty(); });
+    if (closing) return false;
+    a = std::move(queue.front());
+    queue.pop_front();
+    return true;
+}
+
+void analysis_server::run_worker() {
+    static_evaluator eval;
+    std::unique_ptr<engine> eng = shared_tt ? std::make_unique<engine>(eval, options.depth, shared_tt)
+                                            : std::make_unique<engine>(eval, options.depth, options.hash);
+    eng->uci_output = false;
+    analysis a;
+    while (next_analysis(a)) {
+        session& s = *a.owner;
+        int depth = 0;
+        int score = 0;
+        eng->on_iteration = [&] (int d, move, int val) {
+            depth = d;
+            score = val;
+        };
+        eng->max_depth = a.depth;
+        eng->max_nodes = a.nodes;
+        auto begin = std::chrono::steady_clock::now();
+        eng->start_search(a.g, a.time);
+        {
+            // a stop or a disconnect that came before the engine was searching is passed on now
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.searching = eng.get();
+            if (s.stop_requested || s.closed) eng->stop();
+        }
+        move m = eng->wait_search();
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+        analyses++;
+        nodes += eng->searched_nodes();
+
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.searching = nullptr;
+            s.busy = false;
+            if (!s.closed) {
+                std::ostringstream ss;
+                ss << "bestmove " << (m == null_move ? "(none)" : to_long_move(m)) << " score " << format_score(score)
+                   << " depth " << depth << " nodes " << eng->searched_nodes() << " time " << elapsed.count();
+                s.send(ss.str());
+                if (!s.output.empty()) wake();
+            }
+        }
+        a.owner.reset();
+    }
+}
+
+std::string analysis_server::report() {
+    double seconds = std::max(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), 1e-3);
+    size_t queued;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        queued = queue.size();
+    }
+    std::ostringstream ss;
+    ss << "sessions " << sessions.size() << " queued " << queued << " analyses " << analyses
+       << " analyses/s " << analyses / seconds << " nodes " << nodes << " nps " << uint64_t(nodes / seconds);
+    return ss.str();
+}
@@ -0,0 +1,118 @@
+#ifndef CHESSENGINE_ANALYSIS_SERVER_H
+#define CHESSENGINE_ANALYSIS_SERVER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <sys/types.h>
+#include <chess/game.h>
+#include <chess/engine/engine.h>
+#include <chess/engine/transposition_table.h>
+
+struct server_options {
+    std::string socket_path;
+    int workers = int(std::thread::hardware_concurrency());
+    size_t hash = 1 << 20; // TT entries of every worker, or of the one table they share
+    bool shared_hash = false;
+    // the limits of every analysis: a session can ask for less, never for more; 0 for none
+    std::chrono::milliseconds time{1000};
+    uint64_t nodes = 0;
+    int depth = 30;
+};
+
+// one client connection and the analysis it is waiting for
+struct session {
+    const int fd;
+    // guards the state below; sends don't block, so it is never held while waiting for the client
+    std::mutex mutex;
+    std::string output; // lines the socket hasn't taken yet
+    bool busy = false;
+    bool closed = false;
+    bool stop_requested = false;
+    engine* searching = nullptr;
+
+    // used by the connection thread only
+    chess::core::game g;
+    std::string input;
+
+    explicit session(int fd);
+
+    // the descriptor stays open until the last analysis holding the session is done, so it can't be reused meanwhile
+    ~session();
+
+    // the caller holds mutex; queues the line and writes what the socket takes without blocking
+    void send(const std::string& line);
+
+    // the caller holds mutex; false when the client went away
+    bool flush();
+};
+
+struct analysis {
+    std::shared_ptr<session> owner;
+    chess::core::game g;
+    std::chrono::milliseconds time;
+    uint64_t nodes;
+    int depth;
+};
+
+// Serves analyses to any number of sessions over a Unix domain socket. One thread multiplexes the connections and
+// queues the analyses they ask for; a pool of workers, each with its own engine, searches them.
+// Every session speaks a line protocol resembling UCI:
+//   position startpos|fen <fen> [moves ...]
+//   go [movetime <ms>] [depth <n>] [nodes <n>]   answered by "bestmove <move> score cp|mate <v> depth <d> nodes <n> time <ms>"
+//   stop, isready, stats, quit
+class analysis_server {
+    server_options options;
+    int listen_fd = -1;
+    // identify the socket file, so the server never removes a file that took its place
+    dev_t socket_device = 0;
+    ino_t socket_inode = 0;
+    int wake_fds[2] = {-1, -1}; // a worker leaving output behind writes to the pipe, so the next poll waits to send it
+    std::map<int, std::shared_ptr<session>> sessions; // by descriptor
+    std::shared_ptr<tt_storage> shared_tt;
+
+    std::mutex queue_mutex; // guards queue and closing
+    std::condition_variable queue_changed;
+    std::deque<analysis> queue;
+    bool closing = false;
+    std::vector<std::thread> workers;
+
+    std::chrono::steady_clock::time_point start;
+    std::atomic<uint64_t> analyses = 0;
+    std::atomic<uint64_t> nodes = 0;
+
+    void accept_session();
+
+    // false when the client went away
+    bool read_session(session& s);
+
+    void handle_command(session& s, const std::string& line);
+
+    void wake();
+
+    void close_session(session& s);
+
+    bool next_analysis(analysis& a);
+
+    void run_worker();
+
+public:
+    explicit analysis_server(server_options options);
+
+    ~analysis_server();
+
+    // serves until stopping is set
+    void run(const std::atomic<bool>& stopping);
+
+    // throughput since the start, e.g. "sessions 3 queued 0 analyses 120 analyses/s 11.9 nodes 1200000 nps 119000"
+    std::string report();
+};
+
+#endif //CHESSENGINE_ANALYSIS_SERVER_H
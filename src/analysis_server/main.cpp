@@ -0,0 +1,45 @@
+#include <iostream>
+#include <string>
+#include <atomic>
+#include <csignal>
+#include <chess/core.h>
+#include "analysis_server.h"
+
+static std::atomic<bool> stopping = false;
+
+server_options parse_options(int argc, char** argv) {
+    if (argc < 2)
+        throw std::runtime_error("usage: analysis_server <socket> [--workers N] [--hash N] [--shared-hash] "
+                                 "[--time ms] [--nodes N] [--depth N]");
+    server_options options;
+    options.socket_path = argv[1];
+    for (int i = 2; i < argc; i++) {
+        std::string name = argv[i];
+        if (name == "--shared-hash") {
+            options.shared_hash = true;
+            continue;
+        }
+        if (i + 1 >= argc) throw std::runtime_error("missing value of " + name);
+        std::string value = argv[++i];
+        if (name == "--workers") options.workers = std::max(1, std::stoi(value));
+        else if (name == "--hash") options.hash = std::stoul(value);
+        else if (name == "--time") options.time = std::chrono::milliseconds(std::stoi(value));
+        else if (name == "--nodes") options.nodes = std::stoull(value);
+        else if (name == "--depth") options.depth = std::stoi(value);
+        else throw std::runtime_error("unknown option " + name);
+    }
+    return options;
+}
+
+int main(int argc, char** argv) {
+    chess::core::init();
+    server_options options = parse_options(argc, argv);
+    std::signal(SIGINT, [] (int) { stopping = true; });
+    std::signal(SIGTERM, [] (int) { stopping = true; });
+
+    analysis_server server(options);
+    std::cout << "listening on " << options.socket_path << " with " << options.workers << " workers" << std::endl;
+    server.run(stopping);
+    std::cout << server.report() << std::endl;
+    return 0;
+}
@@ -15,13 +15,87 @@
 #include <chess/engine/engine.h>
 #include <chess/engine/evaluator.h>
 #include <chess/engine/transposition_table.h>
+#include <chess/engine/tablebase.h>
+#include <chess/engine/move_legality.h>
 
 using namespace chess::core;
 
+static bool is_quiet(const board& b, move m) {
+    square dest = move_dest(m);
+    return b.piece_at(get_bb(dest)) == NO_PIECE && dest != b.en_passant && move_type(m) < PROMOTION_QUEEN;
+}
+
+// a pawn on the 7th rank can't be stopped by pawns any more, it is always passed
+static bool is_pawn_push_to_seventh(const board& b, move m) {
+    if (b.piece_at(get_bb(move_origin(m))) != PAWN) return false;
+    return get_rank(move_dest(m)) == (b.side_to_play == WHITE ? 6 : 1);
+}
+
+// knights and bishops count the same, so a minor piece recaptured for a minor piece evens the material
+static int exchange_value(piece p) {
+    switch (p) {
+        case PAWN: return 1;
+        case KNIGHT:
+        case BISHOP: return 3;
+        case ROOK: return 5;
+        case QUEEN: return 9;
+        default: return 0;
+    }
+}
+
+// Hands out the moves of a node: the TT move before any generation, so a cutoff by it saves generating and
+// scoring the rest, then the remaining legal moves best first. Killers stay in the scored order: tried before
+// generation they would come ahead of the captures and checks that order better.
+class move_picker {
+    engine& e;
+    const board& b;
+    int ply;
+    move tt_move;
+    bool tt_move_done = false;
+    std::vector<std::pair<move, int>> moves;
+    bool generated = false;
+    int index = 0;
+
+    void generate() {
+        generated = true;
+        moves = e.get_move_scores(b, ply, move_gen(b).generate(), tt_move);
+    }
+
+public:
+    // tt_move is null_move or legal in b
+    move_picker(engine& e, const board& b, int ply, move tt_move) : e(e), b(b), ply(ply), tt_move(tt_move) {}
+
+    bool has_moves() {
+        if (tt_move != null_move) return true;
+        if (!generated) generate();
+        return !moves.empty();
+    }
+
+    // null_move once all moves were handed out
+    move next() {
+        if (!tt_move_done) {
+            tt_move_done = true;
+            if (tt_move != null_move) return tt_move;
+        }
+        if (!generated) generate();
+        while (index < moves.size()) {
+            e.sort_moves(moves, index);
+            move m = moves[index++].first;
+            if (m != tt_move) return m;
+        }
+        return null_move;
+    }
+};
+
 std::pair<move, int> engine::search_iterate(game& g) {
 
     time_over = false;
     initial_search_time = std::chrono::steady_clock::now();
+    time_limit_start = initial_search_time;
+    return iterative_deepening(g);
+}
+
+std::pair<move, int> engine::iterative_deepening(game& g) {
     auto legal_moves = move_gen(g.states.back().b).generate();
     if (legal_moves.empty()) {
         if (g.states.back().b.under_check())
@@ -30,27 +104,107 @@ std::pair<move, int> engine::search_iterate(game& g) {
             return std::make_pair(null_move, 0);
     }
 
-    for (int c = 0; c < 2; c++)
-        for (int i = 0; i < 64; i++)
-            for (int j = 0; j < 64; j++)
-                history[c][i][j] /= 8;
+    reuse_search_data(g);
     nodes = 0;
     qnodes = 0;
     cache_hit_count = 0;
-    // assuming last search was last played move, we can shift the killer move list one ply to the left and hope it will be still valid
-    for (int i = 0; i < killers.size() - 1 && !killers.empty(); i++) {
-        killers[i] = killers[i + 1];
-    }
-
-    bestmove = legal_moves[0];
+    tb_hits = 0;
+    stats.clear();
+
+    init_root_moves(g, legal_moves);
+    bestmove = root_moves[0].m;
+    best_move_changes = 0;
+    int lines = std::min(std::max(multipv, 1), int(root_moves.size()));
+    pv_lines.assign(lines, std::make_pair(null_move, -INF));
     current_depth = 1;
-    int val = search_root(g, current_depth, -INF, +INF);
+    // an iteration cut short by the clock or the node limit returns a meaningless value, usually 0, so the score
+    // is the one of the last iteration searched to the end
+    int score = search_lines(g, current_depth);
+    stats.end_iteration(current_depth, nodes);
+    if (on_iteration) on_iteration(current_depth, bestmove, score);
 
     for (current_depth = 2; current_depth <= max_depth; current_depth++) {
-        if (val > MATE - current_depth) break;
-        val = search_widen(g, current_depth, val);
+        if (score > MATE - current_depth) break;
+        int val = search_lines(g, current_depth);
+        if (time_over) break;
+        score = val;
+        stats.end_iteration(current_depth, nodes);
+        if (on_iteration) on_iteration(current_depth, bestmove, score);
     }
-    return std::make_pair(bestmove, val);
+    return std::make_pair(bestmove, score);
+}
+
+void engine::init_root_moves(const game& g, const std::vector<move>& legal_moves) {
+    std::vector<move> moves;
+    for (move m : legal_moves) {
+        if (search_moves.empty() || std::find(search_moves.begin(), search_moves.end(), m) != search_moves.end())
+            moves.push_back(m);
+    }
+    if (moves.empty()) moves = legal_moves;
+
+    root_moves.clear();
+    // in a tablebase position only the moves keeping the best outcome are searched, in DTZ order
+    if (tablebase::filter_root_moves(g.states.back().b, moves)) {
+        for (move m : moves) root_moves.emplace_back(m);
+        return;
+    }
+
+    tt_node node{};
+    move tt_move = null_move;
+    if (tt.probe(g.states.back().hash, &node)) tt_move = node.bestmove;
+    auto scored = get_move_scores(g.states.back().b, 0, moves, tt_move);
+    std::stable_sort(scored.begin(), scored.end(), [] (auto& a, auto& b) { return a.second > b.second; });
+    for (auto& [m, score] : scored) root_moves.emplace_back(m);
+}
+
+root_relation engine::relate_to_previous_root(const game& g) const {
+    size_t common = 0;
+    while (common < previous_line.size() && common < g.states.size() && previous_line[common] == g.states[common].hash)
+        common++;
+    if (common == 0) return UNRELATED;
+    if (common < previous_line.size()) return DEVIATION;
+    return common == g.states.size() ? SAME_ROOT : CONTINUATION;
+}
+
+void engine::reuse_search_data(const game& g) {
+    root_relation relation = relate_to_previous_root(g);
+    if (relation == CONTINUATION) {
+        // frames are indexed by ply from the root, so their killers move left by the number of plies played since
+        size_t played = std::min(g.states.size() - previous_line.size(), stack.size());
+        std::move(stack.begin() + played, stack.end(), stack.begin());
+        std::fill(stack.end() - played, stack.end(), search_frame{});
+    } else if (relation != SAME_ROOT) {
+        stack.fill(search_frame{});
+    }
+    if (relation == UNRELATED) history->clear();
+    else if (relation != SAME_ROOT) history->age(8);
+    tt.new_search();
+
+    previous_line.clear();
+    for (auto& s : g.states) previous_line.push_back(s.hash);
+}
+
+void engine::new_game() {
+    tt.clear();
+    stack.fill(search_frame{});
+    previous_line.clear();
+    history->clear();
+}
+
+int engine::search_lines(game& g, int depth) {
+    // each line searches the root moves not taken by the lines before it; the children are shared through
+    // the TT, so from the second line on most of the tree is already there
+    for (auto& rm : root_moves) rm.previous_score = rm.score;
+    int val = 0;
+    for (pv_index = 0; pv_index < pv_lines.size(); pv_index++) {
+        int previous = pv_lines[pv_index].second;
+        if (previous == -INF) val = search_root(g, depth, -INF, INF);
+        else val = search_widen(g, depth, previous);
+        if (time_over) break;
+    }
+    pv_index = 0;
+    if (time_over) return val;
+    return pv_lines[0].second;
 }
 
 int engine::search_widen(game& g, int depth, int val) {
@@ -65,31 +219,35 @@ int engine::search_root(game& g, int depth, int alpha, int beta) {
     if (no_more_time()) return 0;
     auto b = g.states.back().b;
     auto hash = g.states.back().hash;
-    tt_node node{};
-    move current_bestmove = bestmove;
-    if (tt.load(hash, depth, alpha, beta, &node) && node.type == EXACT) {
-        if (node.bestmove != null_move)
-            current_bestmove = node.bestmove;
-    }
-    auto legal_moves = get_move_scores(b, 0, move_gen(b).generate(), current_bestmove);
+    stack[1].extensions = 0;
+    // root moves before pv_index belong to the lines already found in this iteration
+    auto first = root_moves.begin() + pv_index;
+    move current_bestmove = first->m;
+    for (auto it = first; it != root_moves.end(); it++) it->score = -INF;
     int val;
     int best = -1;
     int bestval = -INF;
-    for (int i = 0; i < legal_moves.size(); i++) {
-        sort_moves(legal_moves, i);
-        move m = legal_moves[i].first;
+    for (int i = pv_index; i < root_moves.size(); i++) {
+        root_move& rm = root_moves[i];
+        move m = rm.m;
+        uint64_t subtree_start = nodes;
+        set_current_move(b, 0, m);
         g.do_move(m);
         auto _ = auto_undo_last_move(g);
         if (best == -1) {
             val = -search<true>(g, depth - 1, 1, -beta, -alpha);
+            rm.nodes += nodes - subtree_start;
+            if (no_more_time()) return 0;
         } else {
             int tmp = -search<false>(g, depth - 1, 1, -alpha - 1, -alpha);
             if (no_more_time()) return 0;
             if (tmp > alpha) {
                 val = -search<true>(g, depth - 1, 1, -beta, -alpha);
+                rm.nodes += nodes - subtree_start;
                 if (no_more_time()) return 0;
             }
             else {
+                rm.nodes += nodes - subtree_start;
                 continue;
             }
         }
@@ -99,21 +257,31 @@ int engine::search_root(game& g, int depth, int alpha, int beta) {
         }
         if (val > alpha) {
             best = i;
+            rm.score = val;
             current_bestmove = m;
             if (val > beta) {
-                tt.save(hash, depth, val, BETA, m);
+                if (pv_index == 0) tt.save(hash, depth, val, BETA, m);
+                std::stable_sort(first, root_moves.end());
                 return val;
             }
             alpha = val;
-            tt.save(hash, depth, alpha, ALPHA, m);
-            bestmove = current_bestmove;
-            log_score(b, alpha);
+            if (pv_index == 0) {
+                // lines after the first exclude root moves, so their scores must not reach the root TT entry
+                tt.save(hash, depth, alpha, ALPHA, m);
+                if (bestmove != current_bestmove) best_move_changes++;
+                bestmove = current_bestmove;
+            }
+            log_score(b, current_bestmove, alpha);
             if (val >= MATE - depth) break;
         }
     }
     assert(best > -1);
-    bestmove = current_bestmove;
-    tt.save(hash, depth, alpha, EXACT, bestmove);
+    std::stable_sort(first, root_moves.end());
+    pv_lines[pv_index] = std::make_pair(current_bestmove, alpha);
+    if (pv_index == 0) {
+        bestmove = current_bestmove;
+        tt.save(hash, depth, alpha, EXACT, bestmove);
+    }
     return alpha;
 }
 
@@ -130,30 +298,56 @@ int engine::search(game& g, int depth, int ply, int alpha, int beta) {
     if (alpha >= beta) return alpha;
 
     if (g.is_draw_by_3foldrep() || g.is_draw_by_50move()) return 0;
+    if (ply >= MAX_PLY - 1) return eval.eval(b) * (b.side_to_play == BLACK ? -1 : 1);
 
-    tt_node node;
+    search_frame& frame = stack[ply];
+    if (frame.excluded_move != null_move) hash = excluded_move_hash(hash, frame.excluded_move);
+
+    tt_node node{};
     move tt_move = null_move;
     int val;
+    SEARCH_STATS_INC(stats.tt_probes);
     if (tt.load(hash, depth, alpha, beta, &node)) {
         cache_hit_count++;
+        SEARCH_STATS_INC(stats.tt_hits);
         tt_move = node.bestmove;
         val = node.value;
         if (!is_pv || (alpha < val && val < beta)) {
+            SEARCH_STATS_INC(stats.tt_cutoffs[node.type]);
             if (std::abs(val) > MATE - 100) {
                 if (val > 0) val = val - ply;
                 else val = val + ply;
             }
             return val;
         }
-    } else if (tt.load(hash, -1, -INF, INF, &node)) {
+    } else if (tt.probe(hash, &node)) {
+        SEARCH_STATS_INC(stats.tt_hits);
         tt_move = node.bestmove;
     }
+    // the entry may belong to another position with the same 16-bit key
+    if (tt_move != null_move && !is_legal(b, tt_move)) tt_move = null_move;
 
     if (g.is_draw_by_insufficient_material()) {
         tt.save(hash, INF, 0, EXACT, null_move);
         return 0;
     }
 
+    int wdl;
+    int tb_lower = -INF, tb_upper = INF;
+    if (frame.excluded_move == null_move && tablebase::piece_count(b) <= tablebase::max_pieces() && tablebase::probe_wdl(b, wdl)) {
+        tb_hits++;
+        // a tablebase win is only a lower bound: a mate found by the search is worth more
+        val = tablebase::score(wdl);
+        tt_node_type bound = val > DRAW ? BETA : val < DRAW ? ALPHA : EXACT;
+        if (bound == EXACT || (bound == BETA && val >= beta) || (bound == ALPHA && val <= alpha)) {
+            tt.save(hash, INF, val, bound, tt_move);
+            return val;
+        }
+        // inside the window the bound still holds for the search result
+        if (bound == BETA) tb_lower = val;
+        else tb_upper = val;
+    }
+
     bool in_check = b.under_check(b.side_to_play);
     if (in_check) depth++;
     if (depth <= 0 && !in_check)
@@ -161,8 +355,8 @@ int engine::search(game& g, int depth, int ply, int alpha, int beta) {
 
     nodes++;
 
-    auto legal_moves = get_move_scores(b, ply, move_gen(b).generate(), tt_move);
-    if (legal_moves.empty()) {
+    move_picker picker(*this, b, ply, tt_move);
+    if (!picker.has_moves()) {
         val = 0;
         if (in_check) {
             val = -MATE + ply;
@@ -173,20 +367,24 @@ int engine::search(game& g, int depth, int ply, int alpha, int beta) {
         return val;
     }
 
+    if (!in_check) frame.static_eval = eval.eval(b) * (b.side_to_play == BLACK ? -1 : 1);
+
     if (depth < 3
         && !is_pv
         && !in_check
         && abs(beta - 1) > -MATE + 100)
     {
-        int static_eval = eval.eval(b) * (b.side_to_play == BLACK ? -1 : 1);
-
         int eval_margin = 120 * depth;
-        if (static_eval - eval_margin >= beta)
-            return static_eval - eval_margin;
+        if (frame.static_eval - eval_margin >= beta) {
+            SEARCH_STATS_INC(stats.futility_prunes);
+            return frame.static_eval - eval_margin;
+        }
     }
 
 
-    if (!is_pv && !in_check && depth > 2 && can_do_null_move && eval.eval(b) * (b.side_to_play == BLACK ? -1 : 1) >= beta) {
+    if (!is_pv && !in_check && depth > 2 && can_do_null_move && frame.excluded_move == null_move && frame.static_eval >= beta) {
+        SEARCH_STATS_INC(stats.null_move_tries);
+        set_current_move(b, ply, null_move);
         g.do_null_move();
         can_do_null_move = false;
         int nmval;
@@ -197,43 +395,79 @@ int engine::search(game& g, int depth, int ply, int alpha, int beta) {
         can_do_null_move = true;
         g.undo_last_move();
         if (no_more_time()) return 0;
-        if (nmval >= beta) return nmval;
+        if (nmval >= beta) {
+            SEARCH_STATS_INC(stats.null_move_cutoffs);
+            return nmval;
+        }
     }
 
 
     bool raised_alpha = false;
-    int best = -1;
+    move best = null_move;
+    int move_count = 0;
     int bestval = -INF;
     tt_node_type new_tt_node_type = ALPHA;
-    for (int i = 0; i < legal_moves.size(); i++) {
-        sort_moves(legal_moves, i);
-        move m = legal_moves[i].first;
+    // quiet moves searched at this node, the ones before a cutoff get a history malus
+    std::array<move, 64> quiets;
+    int quiet_count = 0;
+    // the TT move is singular when every other move fails low against a margin below its score
+    bool singular_candidate = depth >= 6 && tt_move != null_move && frame.excluded_move == null_move
+            && node.depth >= depth - 3 && node.type != ALPHA && std::abs(node.value) < MATE - 100;
+    for (move m = picker.next(); m != null_move; m = picker.next()) {
+        if (m == frame.excluded_move) continue;
+        move_count++;
+        if (quiet_count < quiets.size() && is_quiet(b, m)) quiets[quiet_count++] = m;
+
+        // extensions beyond the check extension are limited to the iteration depth on every line
+        int extension = 0;
+        if (frame.extensions < current_depth) {
+            if (singular_candidate && m == tt_move) {
+                SEARCH_STATS_INC(stats.singular_tests);
+                int singular_beta = node.value - 2 * depth;
+                frame.excluded_move = m;
+                val = search<false>(g, (depth - 1) / 2, ply, singular_beta - 1, singular_beta);
+                frame.excluded_move = null_move;
+                if (no_more_time()) return 0;
+                if (val < singular_beta) {
+                    SEARCH_STATS_INC(stats.singular_extensions);
+                    extension = 1;
+                }
+            } else if (is_pv && is_even_recapture(b, ply, m)) {
+                SEARCH_STATS_INC(stats.recapture_extensions);
+                extension = 1;
+            } else if (is_pv && is_pawn_push_to_seventh(b, m)) {
+                SEARCH_STATS_INC(stats.pawn_push_extensions);
+                extension = 1;
+            }
+        }
+        stack[ply + 1].extensions = frame.extensions + extension;
+        int new_depth = depth - 1 + extension;
+
+        set_current_move(b, ply, m);
         g.do_move(m);
         auto _ = auto_undo_last_move(g);
         if (!raised_alpha) {
-            val = -search<is_pv>(g, depth - 1, ply + 1, -beta, -alpha);
+            val = -search<is_pv>(g, new_depth, ply + 1, -beta, -alpha);
             if (no_more_time()) return 0;
         } else {
-            int tmp = -search<false>(g, depth - 1, ply + 1, -alpha - 1, -alpha);
+            int tmp = -search<false>(g, new_depth, ply + 1, -alpha - 1, -alpha);
             if (no_more_time()) return 0;
             if (tmp > alpha) {
-                val = -search<true>(g, depth - 1, ply + 1, -beta, -alpha);
+                val = -search<true>(g, new_depth, ply + 1, -beta, -alpha);
                 if (no_more_time()) return 0;
             }
             else continue;
         }
         if (val > bestval) {
             bestval = val;
-            best = i;
+            best = m;
         }
         if (val > alpha) {
-            best = i;
+            best = m;
             if (val >= beta) {
-                square dest = move_dest(m);
-                if (b.piece_at(get_bb(dest)) == NO_PIECE && dest != b.en_passant && move_type(m) < PROMOTION_QUEEN) {
-                    history[b.side_to_play][move_origin(m)][move_dest(m)] += depth * depth;
-                    set_killer_move(m, ply);
-                }
+                SEARCH_STATS_INC(stats.fail_high);
+                if (move_count == 1) SEARCH_STATS_INC(stats.fail_high_first);
+                if (is_quiet(b, m)) update_quiet_stats(b, ply, depth, m, quiets.data(), quiet_count);
                 new_tt_node_type = BETA;
                 alpha = val;
                 break;
@@ -244,23 +478,33 @@ int engine::search(game& g, int depth, int ply, int alpha, int beta) {
             if (val >= MATE - depth) break;
         }
     }
+    // only possible when the excluded move was the only legal one
+    if (best == null_move) return alpha;
+    if (alpha < tb_lower) {
+        alpha = tb_lower;
+        new_tt_node_type = BETA;
+    } else if (alpha > tb_upper) {
+        alpha = tb_upper;
+        new_tt_node_type = ALPHA;
+    }
     if (alpha > MATE - 100) {
         if (MATE - (alpha + ply) <= depth)
-            tt.save(hash, INF, alpha + ply, new_tt_node_type, legal_moves[best].first);
+            tt.save(hash, INF, alpha + ply, new_tt_node_type, best);
         else
-            tt.save(hash, depth, alpha + ply, new_tt_node_type, legal_moves[best].first);
+            tt.save(hash, depth, alpha + ply, new_tt_node_type, best);
     } else if (alpha < -MATE + 100) {
-        tt.save(hash, depth, alpha - ply, new_tt_node_type, legal_moves[best].first);
+        tt.save(hash, depth, alpha - ply, new_tt_node_type, best);
     } else {
-        tt.save(hash, depth, alpha, new_tt_node_type, legal_moves[best].first);
+        tt.save(hash, depth, alpha, new_tt_node_type, best);
     }
     return alpha;
 }
 
 std::vector<std::pair<move, int>> engine::get_move_scores(const board& b, int ply, const std::vector<move>& moves, const move tt_move) {
     std::vector<std::pair<move, int>> ret;
+    move counter = counter_move(b, ply);
     for (auto m : moves) {
-        int score = history[b.side_to_play][move_origin(m)][move_dest(m)];
+        int score = quiet_move_score(b, ply, m);
         board bnew = b;
         bnew.make_move(m);
         if (m == tt_move) score += 1'000'000'000;
@@ -274,9 +518,10 @@ std::vector<std::pair<move, int>> engine::get_move_scores(const board& b, int pl
             else if (captured == KNIGHT) score += 225;
         }
         if (b.piece_at(get_bb(move_origin(m))) == PAWN && (get_rank(move_dest(m)) % 8) == 0) score += 90'000'000;
-        if (killers.size() > ply) {
-            if (killers[ply].first == m) score += 80'000'000;
-            if (killers[ply].second == m) score += 79'999'999;
+        if (ply < MAX_PLY) {
+            if (stack[ply].killers.first == m) score += 80'000'000;
+            else if (stack[ply].killers.second == m) score += 79'999'999;
+            else if (counter == m) score += 70'000'000;
         }
         ret.emplace_back(m, score);
     }
@@ -299,39 +544,101 @@ void engine::sort_moves(std::vector<std::pair<move, int>>& moves, int first) {
     }
 }
 
-engine::engine(evaluator& e, int max_depth) : eval(e), max_depth(max_depth) {
-    for (int c = 0; c < 2; c++)
-        for (int i = 0; i < 64; i++)
-            for (int j = 0; j < 64; j++)
-                history[c][i][j] = 0;
+engine::engine(evaluator& e, int max_depth, size_t tt_size)
+        : history(std::make_unique<move_history>()), tt(tt_size), eval(e), max_depth(max_depth) {
+    history->clear();
+}
+
+engine::engine(evaluator& e, int max_depth, std::shared_ptr<tt_storage> shared_tt)
+        : history(std::make_unique<move_history>()), tt(std::move(shared_tt)), eval(e), max_depth(max_depth) {
+    history->clear();
+}
+
+engine::~engine() {
+    stop();
+    wait_search();
 }
 
 void engine::set_killer_move(move m, int ply) {
-    if (killers.size() <= ply) {
-        killers.resize(ply + 1, std::make_pair(null_move, null_move));
+    auto& killers = stack[ply].killers;
+    if (killers.first != m) {
+        killers.second = killers.first;
+        killers.first = m;
+    }
+}
+
+void engine::set_current_move(const board& b, int ply, move m) {
+    stack[ply].current_move = m;
+    stack[ply].moved_piece = m == null_move ? NO_PIECE : b.piece_at(get_bb(move_origin(m)));
+    stack[ply].captured_piece = m == null_move ? NO_PIECE : b.piece_at(get_bb(move_dest(m)));
+}
+
+bool engine::is_even_recapture(const board& b, int ply, move m) const {
+    if (ply == 0) return false;
+    const search_frame& previous = stack[ply - 1];
+    return previous.current_move != null_move && previous.captured_piece != NO_PIECE
+           && move_dest(previous.current_move) == move_dest(m)
+           && exchange_value(b.piece_at(get_bb(move_dest(m)))) == exchange_value(previous.captured_piece);
+}
+
+int engine::quiet_move_score(const board& b, int ply, move m) const {
+    int score = history->butterfly[b.side_to_play][move_origin(m)][move_dest(m)];
+    if (ply >= MAX_PLY) return score;
+    piece p = b.piece_at(get_bb(move_origin(m)));
+    for (int k = 0; k < 2 && k < ply; k++) {
+        const search_frame& previous = stack[ply - 1 - k];
+        if (previous.current_move == null_move) continue;
+        score += history->continuation[k][b.side_to_play][previous.moved_piece][move_dest(previous.current_move)][p][move_dest(m)];
     }
+    return score;
+}
 
-    if (killers[ply].first != m) {
-        killers[ply].second = killers[ply].first;
-        killers[ply].first = m;
+move engine::counter_move(const board& b, int ply) const {
+    if (ply == 0 || ply >= MAX_PLY || stack[ply - 1].current_move == null_move) return null_move;
+    const search_frame& previous = stack[ply - 1];
+    return history->counter_moves[b.side_to_play][previous.moved_piece][move_dest(previous.current_move)];
+}
+
+void engine::update_quiet_stats(const board& b, int ply, int depth, move best, const move* quiets, int quiet_count) {
+    set_killer_move(best, ply);
+    if (ply > 0 && stack[ply - 1].current_move != null_move) {
+        const search_frame& previous = stack[ply - 1];
+        history->counter_moves[b.side_to_play][previous.moved_piece][move_dest(previous.current_move)] = best;
+    }
+
+    int bonus = history_bonus(depth);
+    for (int i = 0; i < quiet_count; i++) {
+        move m = quiets[i];
+        int delta = m == best ? bonus : -bonus;
+        piece p = b.piece_at(get_bb(move_origin(m)));
+        update_history(history->butterfly[b.side_to_play][move_origin(m)][move_dest(m)], delta);
+        for (int k = 0; k < 2 && k < ply; k++) {
+            const search_frame& previous = stack[ply - 1 - k];
+            if (previous.current_move == null_move) continue;
+            update_history(history->continuation[k][b.side_to_play][previous.moved_piece][move_dest(previous.current_move)][p][move_dest(m)], delta);
+        }
     }
 }
 
-int engine::qsearch(game& g, int ply, int alpha, int beta) {
+int engine::qsearch(game& g, int ply, int alpha, int beta, int qdepth) {
     if (no_more_time()) return 0;
     if (g.is_draw_by_3foldrep() || g.is_draw_by_50move()) return 0;
     const board& b = g.states.back().b;
     nodes++;
     qnodes++;
+    SEARCH_STATS_INC(stats.qsearch_nodes[std::min(qdepth, search_stats::MAX_QDEPTH - 1)]);
     uint64_t hash = g.states.back().hash;
     tt_node node;
     move tt_move = null_move;
     int val;
+    SEARCH_STATS_INC(stats.tt_probes);
     if (tt.load(hash, 0, &node)) {
+        SEARCH_STATS_INC(stats.tt_hits);
         val = node.value;
         tt_move = node.bestmove;
         if (node.type == EXACT) {
             if (alpha < val && val < beta) {
+                SEARCH_STATS_INC(stats.tt_cutoffs[EXACT]);
                 if (std::abs(val) > MATE - 100) {
                     if (val > 0) val = val - ply;
                     else val = val + ply;
@@ -368,9 +675,10 @@ int engine::qsearch(game& g, int ply, int alpha, int beta) {
         move m = legal_moves[i].first;
         //auto bnew = g.states.back().b;
         if (b.piece_at(get_bb(move_dest(m))) != NO_PIECE || move_type(m) >= PROMOTION_QUEEN || (move_dest(m) == b.en_passant && b.piece_at(get_bb(move_origin(m))) == PAWN)) {
+            if (ply < MAX_PLY) set_current_move(b, ply, m);
             g.do_move(m);
             auto _ = auto_undo_last_move(g);
-            val = -qsearch(g, ply + 1, -beta, -alpha);
+            val = -qsearch(g, ply + 1, -beta, -alpha, qdepth + 1);
             if (no_more_time()) return 0;
             if (val > alpha) {
                 if (val >= beta) return val;
@@ -381,11 +689,12 @@ int engine::qsearch(game& g, int ply, int alpha, int beta) {
     return alpha;
 }
 
-void engine::log_score(const board& b, int val) {
-    if (time_over) return;
+void engine::log_score(const board& b, move m, int val) {
+    if (time_over || !uci_output) return;
     int mate = MATE - std::abs(val);
     std::stringstream ss;
     ss << "info depth " << current_depth;
+    ss << " multipv " << (pv_index + 1);
     if (mate < 30) {
         if (val < 0)
             ss << " score mate -" << mate;
@@ -399,17 +708,19 @@ void engine::log_score(const board& b, int val) {
     long time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - initial_search_time).count();
     ss << " nodes " << nodes;
     ss << " qnodes " << qnodes;
-    ss << " nps " << int(double(nodes) * 1'000'000'000 / double(time));
+    ss << " nps " << uint64_t(double(nodes) * 1'000'000'000 / double(time));
     ss << " time " << (time / 1'000'000);
     ss << " tthit " << cache_hit_count;
-    ss << " pv " << to_long_move(bestmove);
+    ss << " hashfull " << tt.hashfull();
+    ss << " tbhits " << tb_hits;
+    ss << " pv " << to_long_move(m);
     tt_node node{};
     board b2 = b;
-    b2.make_move(bestmove);
+    b2.make_move(m);
 
     for (int i = 1; i < current_depth; i++) {
         auto hash = zobrist::hash(b2);
-        if (tt.load(hash, 0, &node) && node.bestmove != null_move) {
+        if (tt.load(hash, 0, &node) && is_legal(b2, node.bestmove)) {
             ss << " " << to_long_move(node.bestmove);
             b2.make_move(node.bestmove);
         } else {
@@ -419,25 +730,75 @@ void engine::log_score(const board& b, int val) {
     std::cout << ss.str() << std::endl;
 }
 
-move engine::timed_search(game& g, const std::chrono::milliseconds& time) {
+move engine::timed_search(game& g, const std::chrono::milliseconds& time, bool ponder) {
+    start_search(g, time, ponder);
+    return wait_search();
+}
+
+void engine::start_search(game& g, const std::chrono::milliseconds& time, bool ponder) {
     using namespace std::chrono_literals;
+    wait_search();
+    // everything stop() and ponderhit() touch is set up before the thread starts, so neither can get lost
     time_over = false;
+    pondering = ponder;
     bestmove = null_move;
     max_time = time;
-    std::future<void> fut = std::async(std::launch::async, [&] () {
-        search_iterate(g);
-        if (!time_over) std::cout << "bestmove " << to_long_move(bestmove) << std::endl;
+    initial_search_time = std::chrono::steady_clock::now();
+    time_limit_start = initial_search_time;
+    if (!ponder && book.is_open()) {
+        bestmove = book.probe(g.states.back().b);
+        if (bestmove != null_move) {
+            if (uci_output) std::cout << "bestmove " << to_long_move(bestmove) << std::endl;
+            return;
+        }
+    }
+    search_thread = std::thread([this, &g] () {
+        iterative_deepening(g);
+        // a ponder search that finished early has to hold its bestmove until ponderhit or stop
+        while (pondering && !time_over) std::this_thread::sleep_for(1ms);
+        if (!uci_output) return;
+        std::stringstream ss;
+        ss << "bestmove " << to_long_move(bestmove);
+        move pm = ponder_move(g.states.back().b);
+        if (pm != null_move) ss << " ponder " << to_long_move(pm);
+        std::cout << ss.str() << std::endl;
     });
-    fut.get();
+}
+
+move engine::wait_search() {
+    if (search_thread.joinable()) search_thread.join();
     return bestmove;
 }
 
+void engine::stop() {
+    pondering = false;
+    time_over = true;
+}
+
+void engine::ponderhit() {
+    time_limit_start = std::chrono::steady_clock::now();
+    pondering = false;
+}
+
+move engine::ponder_move(const board& b) {
+    if (bestmove == null_move) return null_move;
+    board after = b;
+    after.make_move(bestmove);
+    tt_node node{};
+    if (!tt.load(zobrist::hash(after), -1, &node) || !is_legal(after, node.bestmove)) return null_move;
+    return node.bestmove;
+}
+
 bool engine::no_more_time() {
     if (time_over) return true;
+    if (pondering) return false;
+    if (max_nodes > 0 && nodes >= max_nodes) {
+        time_over = true;
+        return true;
+    }
     if (max_time.count() == 0) return false;
-    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - initial_search_time);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - time_limit_start.load());
     time_over = elapsed >= max_time;
-    if (time_over) std::cout << "bestmove " << to_long_move(bestmove) << std::endl;
     return time_over;
 }
 
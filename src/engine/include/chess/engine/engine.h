@@ -9,42 +9,115 @@
 #include <chess/move.h>
 #include <chess/board.h>
 #include <unordered_map>
+#include <array>
+#include <memory>
 #include <chrono>
+#include <atomic>
+#include <thread>
+#include <functional>
 #include <chess/game.h>
 #include <chess/zobrist.h>
 #include <chess/engine/evaluator.h>
 #include <chess/engine/transposition_table.h>
+#include <chess/engine/search_stats.h>
+#include <chess/engine/root_move.h>
+#include <chess/engine/opening_book.h>
+#include <chess/engine/search_stack.h>
+#include <chess/engine/move_history.h>
+
+// how the root of a new search relates to the root of the previous one
+enum root_relation {
+    UNRELATED, SAME_ROOT, CONTINUATION, DEVIATION
+};
 
 class engine {
     typedef chess::core::move move;
     typedef chess::core::board board;
     typedef chess::core::game game;
 
-    std::chrono::milliseconds max_time;
+    std::chrono::milliseconds max_time{0};
 
-    std::vector<std::pair<move, move>> killers;
-    int nodes = 0;
-    int qnodes = 0;
+    std::array<search_frame, MAX_PLY> stack;
+    uint64_t nodes = 0;
+    uint64_t qnodes = 0;
     int current_depth = -1;
-    int cache_hit_count = 0;
-    int history[2][64][64];
-    transposition_table tt{10'000'000};
+    int pv_index = 0;
+    uint64_t cache_hit_count = 0;
+    uint64_t tb_hits = 0;
+    std::unique_ptr<move_history> history;
+    transposition_table tt;
     bool can_do_null_move = true;
     std::chrono::steady_clock::time_point initial_search_time;
+    // max_time counts from here; ponderhit moves it to the moment the ponder search became a real one
+    std::atomic<std::chrono::steady_clock::time_point> time_limit_start;
+    std::thread search_thread;
+    std::vector<uint64_t> previous_line; // hashes from the start of the game to the previous search root
     evaluator& eval;
 
     bool no_more_time();
+
+    std::pair<move, int> iterative_deepening(game& g);
+
+    void reuse_search_data(const game& g);
+
+    void set_current_move(const board& b, int ply, move m);
+
+    int quiet_move_score(const board& b, int ply, move m) const;
+
+    move counter_move(const board& b, int ply) const;
+
+    // takes back on the square of the last capture a piece worth the one lost there
+    bool is_even_recapture(const board& b, int ply, move m) const;
+
+    void update_quiet_stats(const board& b, int ply, int depth, move best, const move* quiets, int quiet_count);
 public:
-    bool time_over = false;
+    std::atomic<bool> time_over = false;
+    std::atomic<bool> pondering = false;
     move bestmove;
     int max_depth;
+    uint64_t max_nodes = 0; // node budget of a search, 0 for none; makes a search reproducible for a given TT size
+    int multipv = 1;
+    bool uci_output = true;
+    std::vector<move> search_moves;
+    std::vector<root_move> root_moves;
+    std::vector<std::pair<move, int>> pv_lines;
+    int best_move_changes = 0;
+    search_stats stats;
+    opening_book book;
+    // called from the search thread after every completed iteration with its depth, best move and score
+    std::function<void(int, move, int)> on_iteration;
+
+    engine(evaluator& e, int max_depth = 30, size_t tt_size = 10'000'000);
+
+    // an engine whose transposition table works on slots shared with other engines searching at the same time
+    engine(evaluator& e, int max_depth, std::shared_ptr<tt_storage> shared_tt);
 
-    engine(evaluator& e, int max_depth = 30);
+    ~engine();
 
-    move timed_search(game& g, const std::chrono::milliseconds& time);
+    move timed_search(game& g, const std::chrono::milliseconds& time, bool ponder = false);
+
+    void start_search(game& g, const std::chrono::milliseconds& time, bool ponder = false);
+
+    move wait_search();
+
+    void stop();
+
+    uint64_t searched_nodes() const { return nodes; }
+
+    void new_game();
+
+    root_relation relate_to_previous_root(const game& g) const;
+
+    void ponderhit();
+
+    move ponder_move(const board& b);
 
     std::pair<move, int> search_iterate(game& g);
 
+    void init_root_moves(const game& g, const std::vector<move>& legal_moves);
+
+    int search_lines(game& g, int depth);
+
     int search_widen(game& g, int depth, int val);
 
     int search_root(game& g, int depth, int alpha, int beta);
@@ -54,9 +127,9 @@ public:
 
     void set_killer_move(move m, int ply);
 
-    void log_score(const board& b, int val);
+    void log_score(const board& b, move m, int val);
 
-    int qsearch(game& g, int ply, int alpha, int beta);
+    int qsearch(game& g, int ply, int alpha, int beta, int qdepth = 0);
 
     std::vector<std::pair<move, int>>
     get_move_scores(const board& b, int ply, const std::vector<move>& moves, const move tt_move);
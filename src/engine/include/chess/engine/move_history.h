@@ -0,0 +1,48 @@
+#ifndef CHESSENGINE_MOVE_HISTORY_H
+#define CHESSENGINE_MOVE_HISTORY_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <chess/move.h>
+#include <chess/board.h>
+
+constexpr int MAX_HISTORY = 16384;
+
+// moves a history entry toward +-MAX_HISTORY; the step shrinks as the entry gets closer, so entries never
+// leave [-MAX_HISTORY, MAX_HISTORY] and recent results outweigh old ones
+template<typename T>
+void update_history(T& entry, int bonus) {
+    bonus = std::clamp(bonus, -MAX_HISTORY, MAX_HISTORY);
+    entry += bonus - int(entry) * std::abs(bonus) / MAX_HISTORY;
+}
+
+inline int history_bonus(int depth) {
+    return std::min(16 * depth * depth, MAX_HISTORY / 4);
+}
+
+// statistics about quiet moves, about 1.2MB, so the engine keeps them on the heap
+struct move_history {
+    // [side to move][from][to]
+    int butterfly[2][64][64];
+    // reply that refuted the previous move, [side to move][piece][to] of the previous move
+    chess::core::move counter_moves[2][6][64];
+    // [plies back - 1][side to move][piece][to] of the earlier move, then [piece][to] of the current one
+    int16_t continuation[2][2][6][64][6][64];
+
+    void clear() {
+        std::fill_n(&butterfly[0][0][0], sizeof(butterfly) / sizeof(int), 0);
+        std::fill_n(&counter_moves[0][0][0], sizeof(counter_moves) / sizeof(chess::core::move), chess::core::null_move);
+        std::fill_n(&continuation[0][0][0][0][0][0], sizeof(continuation) / sizeof(int16_t), 0);
+    }
+
+    // keeps a fraction of the statistics for a search that is related to the previous one
+    void age(int divisor) {
+        int* b = &butterfly[0][0][0];
+        std::transform(b, b + sizeof(butterfly) / sizeof(int), b, [=] (int h) { return h / divisor; });
+        int16_t* c = &continuation[0][0][0][0][0][0];
+        std::transform(c, c + sizeof(continuation) / sizeof(int16_t), c, [=] (int16_t h) { return int16_t(h / divisor); });
+    }
+};
+
+#endif //CHESSENGINE_MOVE_HISTORY_H
@@ -0,0 +1,19 @@
+#ifndef CHESSENGINE_MOVE_LEGALITY_H
+#define CHESSENGINE_MOVE_LEGALITY_H
+
+#include <chess/move.h>
+#include <chess/board.h>
+
+// Checks for moves that don't come from the move generator of this position, like the TT move or the killers,
+// so they can be searched before generating. Castling and en passant are rare enough to be left to the generator.
+
+// the piece on the origin belongs to the side to move and can reach the destination
+bool is_pseudo_legal(const chess::core::board& b, chess::core::move m);
+
+// pseudo-legal and doesn't leave the own king in check
+bool is_legal(const chess::core::board& b, chess::core::move m);
+
+// castling is told apart by the king moving two files, whatever type the move generator gave the move
+bool is_castling(const chess::core::board& b, chess::core::move m);
+
+#endif //CHESSENGINE_MOVE_LEGALITY_H
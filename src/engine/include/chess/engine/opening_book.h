@@ -0,0 +1,59 @@
+#ifndef CHESSENGINE_OPENING_BOOK_H
+#define CHESSENGINE_OPENING_BOOK_H
+
+#include <cstdint>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <chess/move.h>
+#include <chess/board.h>
+
+// Read-only view of a book in Polyglot .bin layout: 16-byte big-endian entries (key, move, weight, learn)
+// sorted by key. The file is memory-mapped and probed in place, nothing is copied to the heap.
+// Positions are looked up by their Polyglot key, so any Polyglot book works.
+class opening_book {
+    const unsigned char* data = nullptr;
+    size_t mapped_size = 0;
+    size_t entries = 0;
+    std::mt19937_64 rng{std::random_device()()};
+
+    uint64_t key_at(size_t i) const;
+    uint16_t move_at(size_t i) const;
+    uint16_t weight_at(size_t i) const;
+
+public:
+    static constexpr size_t ENTRY_SIZE = 16;
+
+    opening_book() = default;
+
+    opening_book(const opening_book&) = delete;
+
+    opening_book& operator=(const opening_book&) = delete;
+
+    ~opening_book();
+
+    // false when the engine was built without the Polyglot Random64 table; no book can be opened then
+    static bool has_keys();
+
+    bool open(const std::string& path);
+
+    void close();
+
+    bool is_open() const { return data != nullptr; }
+
+    size_t size() const { return entries; }
+
+    // Polyglot key of the position
+    static uint64_t key(const chess::core::board& b);
+
+    // raw Polyglot move of an entry for this key, picked with probability proportional to its weight, or the
+    // heaviest one when random is false; 0 if the key is not in the book
+    uint16_t probe(uint64_t key, bool random = true);
+
+    // book move for the position as an engine move, null_move if there is none or it is not legal here
+    chess::core::move probe(const chess::core::board& b, bool random = true);
+
+    static chess::core::move to_move(const chess::core::board& b, uint16_t polyglot_move);
+};
+
+#endif //CHESSENGINE_OPENING_BOOK_H
@@ -0,0 +1,23 @@
+#ifndef CHESSENGINE_ROOT_MOVE_H
+#define CHESSENGINE_ROOT_MOVE_H
+
+#include <cstdint>
+#include <chess/move.h>
+#include <chess/engine/evaluator.h>
+
+struct root_move {
+    chess::core::move m;
+    int score = -INF; // -INF unless the move raised alpha in the current iteration
+    int previous_score = -INF;
+    uint64_t nodes = 0; // nodes spent in this move's subtree since the search started, for time management
+
+    explicit root_move(chess::core::move m) : m(m) {}
+
+    // orders better moves first; moves that failed low keep their order from the previous iteration
+    bool operator<(const root_move& other) const {
+        if (score != other.score) return score > other.score;
+        return previous_score > other.previous_score;
+    }
+};
+
+#endif //CHESSENGINE_ROOT_MOVE_H
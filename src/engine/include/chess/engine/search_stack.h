@@ -0,0 +1,22 @@
+#ifndef CHESSENGINE_SEARCH_STACK_H
+#define CHESSENGINE_SEARCH_STACK_H
+
+#include <utility>
+#include <chess/move.h>
+#include <chess/board.h>
+
+// deepest ply the search goes to; frames for all of them are allocated once with the engine
+constexpr int MAX_PLY = 128;
+
+// state of the search at one ply from the root
+struct search_frame {
+    std::pair<chess::core::move, chess::core::move> killers{chess::core::null_move, chess::core::null_move};
+    chess::core::move current_move = chess::core::null_move; // null_move for a null move
+    chess::core::piece moved_piece = chess::core::NO_PIECE;
+    chess::core::piece captured_piece = chess::core::NO_PIECE;
+    chess::core::move excluded_move = chess::core::null_move; // set while the node is searched without this move
+    int extensions = 0; // plies of recapture, pawn push and singular extensions on the line to this node
+    int static_eval = 0; // from the side to move's point of view, not set in check
+};
+
+#endif //CHESSENGINE_SEARCH_STACK_H
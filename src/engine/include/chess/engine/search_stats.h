@@ -0,0 +1,60 @@
+#ifndef CHESSENGINE_SEARCH_STATS_H
+#define CHESSENGINE_SEARCH_STATS_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Counters are only touched when the engine is built with -DSEARCH_STATS=ON,
+// otherwise SEARCH_STATS_INC expands to nothing and the search is unchanged.
+#ifdef SEARCH_STATS
+#define SEARCH_STATS_INC(counter) (++(counter))
+#else
+#define SEARCH_STATS_INC(counter) ((void) 0)
+#endif
+
+struct search_stats {
+    static constexpr int MAX_QDEPTH = 32;
+    static constexpr int MAX_ITERATIONS = 64;
+
+    uint64_t tt_probes = 0;
+    uint64_t tt_hits = 0;
+    uint64_t tt_cutoffs[3] = {}; // indexed by tt_node_type
+    uint64_t null_move_tries = 0;
+    uint64_t null_move_cutoffs = 0;
+    uint64_t futility_prunes = 0;
+    uint64_t singular_tests = 0;
+    uint64_t singular_extensions = 0;
+    uint64_t recapture_extensions = 0;
+    uint64_t pawn_push_extensions = 0;
+    uint64_t fail_high = 0;
+    uint64_t fail_high_first = 0;
+    uint64_t qsearch_nodes[MAX_QDEPTH] = {}; // indexed by plies below the horizon
+    uint64_t iteration_nodes[MAX_ITERATIONS] = {}; // cumulative node count at the end of each iteration
+
+    static constexpr bool enabled() {
+#ifdef SEARCH_STATS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void clear();
+
+    void end_iteration(int depth, uint64_t nodes) {
+#ifdef SEARCH_STATS
+        if (depth < MAX_ITERATIONS) iteration_nodes[depth] = nodes;
+#endif
+    }
+
+    double first_move_fail_high_rate() const;
+
+    double branching_factor() const;
+
+    void print(std::ostream& out) const;
+
+    std::string to_json() const;
+};
+
+#endif //CHESSENGINE_SEARCH_STATS_H
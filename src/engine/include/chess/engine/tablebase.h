@@ -0,0 +1,33 @@
+#ifndef CHESSENGINE_TABLEBASE_H
+#define CHESSENGINE_TABLEBASE_H
+
+#include <string>
+#include <vector>
+#include <chess/move.h>
+#include <chess/board.h>
+
+// Syzygy tablebases, probed through Fathom. The tables are memory-mapped by Fathom and shared by every engine
+// in the process. init is not thread-safe. probe_wdl is, and filter_root_moves serializes the root probes,
+// which Fathom can't run concurrently.
+class tablebase {
+public:
+    // loads every table found in path (several directories separated by ':'); false if none was found
+    static bool init(const std::string& path);
+
+    // largest number of pieces covered by the loaded tables, 0 when there are none
+    static int max_pieces();
+
+    static int piece_count(const chess::core::board& b);
+
+    // win/draw/loss for the side to move: 2 win, 1 cursed win, 0 draw, -1 blessed loss, -2 loss; false unless the
+    // position is covered, has no castling rights and the fifty-move counter is 0
+    static bool probe_wdl(const chess::core::board& b, int& wdl);
+
+    // keeps only the moves that preserve the best outcome, ordered by distance to zeroing; false (and moves
+    // untouched) if the position is not covered
+    static bool filter_root_moves(const chess::core::board& b, std::vector<chess::core::move>& moves);
+
+    static int score(int wdl);
+};
+
+#endif //CHESSENGINE_TABLEBASE_H
@@ -7,50 +7,141 @@
 
 #include <cstdint>
 #include <vector>
+#include <memory>
+#include <atomic>
+#include <bit>
+#include <algorithm>
 #include <chess/move.h>
 
 enum tt_node_type {
     EXACT, ALPHA, BETA
 };
 
+// an entry as handed out by the table
 struct tt_node {
-    uint64_t hash;
     int depth;
     int value;
     tt_node_type type;
     chess::core::move bestmove;
 };
 
+// key of a position searched without one of its moves, so the result doesn't overwrite the position's own entry
+inline uint64_t excluded_move_hash(uint64_t hash, chess::core::move excluded) {
+    return hash ^ ((uint64_t(excluded) + 1) * 0x9E3779B97F4A7C15ULL);
+}
+
+// An entry as stored, 8 bytes with chess-core's 16-bit moves. The lower bits of the hash choose the slot and only
+// the upper 16 are kept to tell positions sharing it apart, so a different position is taken for this one about
+// once in 65536 probes of an occupied slot: moves from the table have to be checked before they are played.
+struct tt_entry {
+    static constexpr int MAX_DEPTH = 127; // deeper entries are stored at this depth, it is beyond any search
+
+    uint16_t key = 0;
+    chess::core::move bestmove{};
+    int16_t value = 0;
+    int8_t depth = 0;
+    uint8_t type_generation = 0; // node type + 1 in the low 2 bits, 0 for an empty slot; the search generation above
+
+    bool empty() const { return (type_generation & 3) == 0; }
+
+    tt_node_type type() const { return tt_node_type((type_generation & 3) - 1); }
+
+    uint8_t generation() const { return type_generation >> 2; }
+};
+
+// The slots of a table. Each entry is read and written as one relaxed atomic word, which costs the same as plain
+// loads and stores, so several engines can share the slots without locks and never see half-written entries.
+typedef std::vector<std::atomic<uint64_t>> tt_storage;
+
 class transposition_table {
     size_t size;
-    std::vector<tt_node> nodes;
+    std::shared_ptr<tt_storage> slots;
+    std::atomic<uint64_t>* entries; // slots->data(), saves the indirection on every probe
+    uint8_t generation = 0; // 6 bits, wraps around; every engine sharing the slots keeps its own
+
+    static uint16_t key(uint64_t hash) {
+        return uint16_t(hash >> 48);
+    }
+
+    tt_entry get(size_t i) const {
+        return std::bit_cast<tt_entry>(entries[i].load(std::memory_order_relaxed));
+    }
+
+    void set(size_t i, const tt_entry& e) {
+        entries[i].store(std::bit_cast<uint64_t>(e), std::memory_order_relaxed);
+    }
+
+    static tt_node unpack(const tt_entry& e) {
+        return tt_node{e.depth, e.value, e.type(), e.bestmove};
+    }
 
 public:
-    explicit transposition_table(size_t size) : size(size) {
-        nodes.resize(size);
+    explicit transposition_table(size_t size)
+            : size(std::max(size, size_t(1))), slots(std::make_shared<tt_storage>(this->size)),
+              entries(slots->data()) {
+    }
+
+    // a table working on slots shared with other tables, e.g. the engines of one process
+    explicit transposition_table(std::shared_ptr<tt_storage> shared_slots)
+            : size(shared_slots->size()), slots(std::move(shared_slots)), entries(slots->data()) {
+    }
+
+    // empties the slots for every table sharing them
+    void clear() {
+        for (auto& slot : *slots) slot.store(0, std::memory_order_relaxed);
+        generation = 0;
+    }
+
+    // entries written by earlier searches stay valid, they just stop being protected from replacement
+    void new_search() {
+        generation = (generation + 1) & 63;
+    }
+
+    // permille of a sample of the table written by the current search, as reported by UCI hashfull
+    int hashfull() const {
+        size_t sample = std::min(size, size_t(1000));
+        int used = 0;
+        for (size_t i = 0; i < sample; i++) {
+            tt_entry e = get(i);
+            if (!e.empty() && e.generation() == generation) used++;
+        }
+        return int(used * 1000 / sample);
     }
 
     void save(uint64_t hash, int depth, int value, tt_node_type type, chess::core::move bestmove) {
         assert(bestmove != 0);
         assert(!(value < 31950 && value > 31000 && type == EXACT));
         assert(!(-value < 31950 && -value > 31000 && type == EXACT));
-        auto& n = nodes[hash % size];
-        if (n.hash == hash) {
+        depth = std::clamp(depth, -tt_entry::MAX_DEPTH, tt_entry::MAX_DEPTH);
+        tt_entry n = get(hash % size);
+        if (!n.empty() && n.key == key(hash)) {
             if (n.depth > depth) return;
-            if (n.depth == depth && n.type == EXACT && type != EXACT) return;
+            if (n.depth == depth && n.type() == EXACT && type != EXACT) return;
+        } else if (!n.empty() && n.generation() == generation && depth <= 0 && n.depth > 0) {
+            // quiescence entries don't evict full-width entries of the running search
+            return;
         }
-        n.hash = hash;
-        n.depth = depth;
-        n.value = value;
-        n.type = type;
+        n.key = key(hash);
+        n.depth = int8_t(depth);
+        n.value = int16_t(value);
         n.bestmove = bestmove;
+        n.type_generation = uint8_t((type + 1) | (generation << 2));
+        set(hash % size, n);
+    }
+
+    // the entry of the position whatever its depth and bound, for its move
+    bool probe(uint64_t hash, tt_node* n) const {
+        tt_entry m = get(hash % size);
+        if (m.empty() || m.key != key(hash)) return false;
+        *n = unpack(m);
+        return true;
     }
 
     bool load(uint64_t hash, int depth, tt_node* n) {
-        tt_node& m = nodes[hash % size];
-        if (m.hash == hash) {
-            *n = m;
-            if (m.depth >= depth) {
+        tt_entry m = get(hash % size);
+        if (!m.empty() && m.key == key(hash)) {
+            *n = unpack(m);
+            if (n->depth >= depth) {
                 return true;
             }
         }
@@ -58,16 +149,16 @@ public:
     }
 
     bool load(uint64_t hash, int depth, int alpha, int beta, tt_node* n) {
-        tt_node& m = nodes[hash % size];
-        if (m.hash == hash) {
-            *n = m;
-            if (m.depth >= depth) {
-                if (m.type == EXACT) return true;
-                if (m.type == ALPHA && m.value <= alpha) {
+        tt_entry m = get(hash % size);
+        if (!m.empty() && m.key == key(hash)) {
+            *n = unpack(m);
+            if (n->depth >= depth) {
+                if (n->type == EXACT) return true;
+                if (n->type == ALPHA && n->value <= alpha) {
                     //n->value = alpha;
                     return true;
                 }
-                if (m.type == BETA && m.value >= beta) {
+                if (n->type == BETA && n->value >= beta) {
                     //n->value = beta;
                     return true;
                 }
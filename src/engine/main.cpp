@@ -3,6 +3,7 @@
 #include <memory>
 #include <algorithm>
 #include <fstream>
+#include <chrono>
 #include <chess/core.h>
 #include <chess/move_gen.h>
 #include <chess/game.h>
@@ -10,6 +11,7 @@
 #include <chess/uci/uci.h>
 #include <chess/engine/engine.h>
 #include <chess/engine/static_evaluator.h>
+#include <chess/engine/tablebase.h>
 
 using std::stringstream;
 using std::string;
@@ -49,6 +51,62 @@ bool do_long_move(game& g, const string& long_move) {
     return false;
 }
 
+std::vector<move> parse_search_moves(const board& b, const std::vector<string>& tokens) {
+    std::vector<move> ret;
+    auto it = std::find(tokens.begin(), tokens.end(), "searchmoves");
+    if (it == tokens.end()) return ret;
+    auto legal_moves = move_gen(b).generate();
+    // the move list ends at the first token that is not a legal move, i.e. the next go parameter
+    for (it++; it != tokens.end(); it++) {
+        auto m = std::find_if(legal_moves.begin(), legal_moves.end(), [&] (move m) { return to_long_move(m) == *it; });
+        if (m == legal_moves.end()) break;
+        ret.push_back(*m);
+    }
+    return ret;
+}
+
+// value following a go parameter, e.g. the N of "go nodes N"; 0 when the parameter is absent
+uint64_t parse_go_value(const std::vector<string>& tokens, const string& name) {
+    auto it = std::find(tokens.begin(), tokens.end(), name);
+    if (it == tokens.end() || ++it == tokens.end()) return 0;
+    return std::stoull(*it);
+}
+
+// fixed positions searched to a fixed depth from a fresh state each, so the node count only changes with the
+// search itself and doubles as a quick functional check and a profiling workload. The table is kept small so
+// setting up each engine stays cheap, and only the searches are timed.
+constexpr size_t bench_tt_size = 1 << 20;
+
+const std::vector<string> bench_positions = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r1qr1b2/1R3pkp/3p2pN/ppnPp1Q1/bn2P3/4P2P/PBBP1PP1/5RK1 w - - 0 1",
+        "r1bq1rk1/pp2bppp/2n2n2/3p4/3P4/2NB1N2/PP3PPP/R1BQ1RK1 w - - 0 1",
+        "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+        "8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+};
+
+void run_bench(evaluator& eval, int depth) {
+    uint64_t total_nodes = 0;
+    std::chrono::steady_clock::duration searching{};
+    for (const auto& fen : bench_positions) {
+        engine eng(eval, depth, bench_tt_size);
+        eng.uci_output = false;
+        game g(chess::core::fen::board_from_fen(fen));
+        auto start = std::chrono::steady_clock::now();
+        auto [m, score] = eng.search_iterate(g);
+        searching += std::chrono::steady_clock::now() - start;
+        total_nodes += eng.searched_nodes();
+        std::cout << "info string " << fen << " bestmove " << to_long_move(m) << " score " << score
+                  << " nodes " << eng.searched_nodes() << std::endl;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(searching);
+    std::cout << "info string bench depth " << depth << " nodes " << total_nodes << " time " << elapsed.count()
+              << " nps " << total_nodes * 1000 / std::max<int64_t>(elapsed.count(), 1) << std::endl;
+}
+
 game handle_position_cmd(const std::vector<string>& tokens) {
     assert(tokens[0] == "position");
     chess::uci::cmd_position position = chess::uci::parse_cmd_position(tokens);
@@ -65,16 +123,54 @@ game handle_position_cmd(const std::vector<string>& tokens) {
         return g;
     }
     if (tokens[1] == "fen") {
+        // the moves are kept in the game so the engine can tell this position continues its previous search
         board b = chess::core::fen::board_from_fen(position.initial_position);
-        return game(b);
+        game g(b);
+        for (int i = 0; i < position.moves.size(); i++) {
+            if (!do_long_move(g, position.moves[i])) {
+                print_illegal_start_sequence_message(position.moves, i);
+                return g;
+            }
+        }
+        return g;
     }
     throw std::runtime_error("position type not implemented");
 }
 
-int main()
+void handle_setoption_cmd(engine& eng, const std::vector<string>& tokens) {
+    assert(tokens[0] == "setoption");
+    string name;
+    string value;
+    int i = 1;
+    if (i < tokens.size() && tokens[i] == "name") i++;
+    for (; i < tokens.size() && tokens[i] != "value"; i++) name += (name.empty() ? "" : " ") + tokens[i];
+    for (i++; i < tokens.size(); i++) value += (value.empty() ? "" : " ") + tokens[i];
+
+    if (name == "MultiPV") {
+        eng.multipv = std::clamp(std::stoi(value), 1, 256);
+    } else if (name == "SyzygyPath") {
+        if (value.empty() || value == "<empty>") return;
+        if (tablebase::init(value)) std::cout << "info string found " << tablebase::max_pieces() << "-piece tablebases" << std::endl;
+        else std::cout << "info string no tablebases found in " << value << std::endl;
+    } else if (name == "BookFile") {
+        if (value.empty() || value == "<empty>") eng.book.close();
+        else if (!opening_book::has_keys()) std::cout << "info string built without the Polyglot keys, no book" << std::endl;
+        else if (!eng.book.open(value)) std::cout << "info string could not open book " << value << std::endl;
+    } else if (name == "Ponder") {
+        // only tells the engine that the GUI may send go ponder, which works either way
+    } else {
+        std::cerr << "unknown option " << name << std::endl;
+    }
+}
+
+int main(int argc, char** argv)
 {
     chess::core::init();
     static_evaluator eval;
+    if (argc > 1 && string(argv[1]) == "bench") {
+        run_bench(eval, argc > 2 ? std::stoi(argv[2]) : 6);
+        return 0;
+    }
     std::unique_ptr<engine> eng = std::make_unique<engine>(eval);
     board b;
     b.set_initial_position();
@@ -86,19 +182,34 @@ int main()
         if (words[0] == "uci") {
             std::cout << "id name chess-engine-name-tbd" << std::endl;
             std::cout << "id author Leon Kacowicz" << std::endl;
+            std::cout << "option name MultiPV type spin default 1 min 1 max 256" << std::endl;
+            std::cout << "option name Ponder type check default false" << std::endl;
+            std::cout << "option name BookFile type string default <empty>" << std::endl;
+            std::cout << "option name SyzygyPath type string default <empty>" << std::endl;
             std::cout << "uciok" << std::endl;
             std::cout.flush();
             continue;
         } else if (words[0] == "quit") {
+            eng->stop();
             break;
         } else if (words[0] == "isready") {
             std::cout << "readyok" << std::endl;
             std::cout.flush();
             continue;
+        } else if (words[0] == "setoption") {
+            eng->wait_search();
+            handle_setoption_cmd(*eng, words);
+            continue;
+        } else if (words[0] == "ucinewgame") {
+            eng->wait_search();
+            eng->new_game();
+            continue;
         } else if (words[0] == "position") {
+            eng->wait_search();
             g = handle_position_cmd(words);
             continue;
         } else if (words[0] == "go") {
+            eng->wait_search();
             chess::uci::cmd_go cmd(words);
             //uci_go_cmd cmd(words);
             if (move_gen(g.states.back().b).generate().empty()) {
@@ -108,14 +219,40 @@ int main()
                 std::cout << "info calculating move for " << cmd.move_time.count() << "ms\n";
                 if (cmd.max_depth > 0) eng->max_depth = cmd.max_depth;
                 else eng->max_depth = 30;
-                eng->timed_search(g, cmd.move_time);
+                eng->max_nodes = parse_go_value(words, "nodes");
+                eng->search_moves = parse_search_moves(g.states.back().b, words);
+                bool ponder = std::find(words.begin(), words.end(), "ponder") != words.end();
+                // the GUI already appended the expected reply to the position, so a ponder search is a normal
+                // search whose clock only starts at ponderhit
+                eng->start_search(g, cmd.move_time, ponder);
             }
+        } else if (words[0] == "stats") {
+            // the counters belong to the search thread until the search is over
+            eng->wait_search();
+            if (!search_stats::enabled()) {
+                std::cout << "info string search statistics disabled, configure with -DSEARCH_STATS=ON" << std::endl;
+            } else if (words.size() > 1 && words[1] == "json") {
+                if (words.size() > 2) {
+                    std::ofstream out(words[2]);
+                    out << eng->stats.to_json() << std::endl;
+                } else {
+                    std::cout << eng->stats.to_json() << std::endl;
+                }
+            } else {
+                eng->stats.print(std::cout);
+            }
+        } else if (words[0] == "bench") {
+            eng->wait_search();
+            run_bench(eval, words.size() > 1 ? std::stoi(words[1]) : 6);
         } else if (words[0] == "print") {
             b.print();
         }
+        else if (words[0] == "ponderhit") {
+            eng->ponderhit();
+        }
         else if (words[0] == "stop") {
-            eng->time_over = true;
-            std::cout << "bestmove " << to_long_move(eng->bestmove) << std::endl;
+            eng->stop();
+            eng->wait_search();
         }
     }
     return 0;
@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <cstdlib>
+#include <chess/move_gen.h>
+
+#include <chess/engine/move_legality.h>
+
+using namespace chess::core;
+
+static bool is_generated(const board& b, move m) {
+    auto moves = move_gen(b).generate();
+    return std::find(moves.begin(), moves.end(), m) != moves.end();
+}
+
+static uint64_t square_bb(int file, int rank) {
+    return uint64_t(1) << (rank * 8 + file);
+}
+
+// no piece between two squares on a line or diagonal
+static bool is_path_clear(uint64_t occupied, square from, int file_delta, int rank_delta) {
+    int file_step = (file_delta > 0) - (file_delta < 0);
+    int rank_step = (rank_delta > 0) - (rank_delta < 0);
+    int steps = std::max(std::abs(file_delta), std::abs(rank_delta));
+    for (int i = 1; i < steps; i++) {
+        if (occupied & square_bb(get_file(from) + i * file_step, get_rank(from) + i * rank_step)) return false;
+    }
+    return true;
+}
+
+bool is_pseudo_legal(const board& b, move m) {
+    if (m == null_move) return false;
+    square from = move_origin(m);
+    square to = move_dest(m);
+    bool white = b.side_to_play == WHITE;
+    uint64_t own = uint64_t(b.piece_of_color[b.side_to_play]);
+    uint64_t enemy = uint64_t(b.piece_of_color[white ? BLACK : WHITE]);
+    uint64_t to_bb = uint64_t(get_bb(to));
+    if (!(own & uint64_t(get_bb(from))) || (own & to_bb)) return false;
+
+    piece p = b.piece_at(get_bb(from));
+    int type = move_type(m);
+    int file_delta = get_file(to) - get_file(from);
+    int rank_delta = get_rank(to) - get_rank(from);
+    if ((type != NORMAL && type < PROMOTION_QUEEN) || is_castling(b, m)
+        || (p == PAWN && to == b.en_passant)) {
+        return is_generated(b, m);
+    }
+    if (type > PROMOTION_KNIGHT) return false;
+    bool promotion = type >= PROMOTION_QUEEN;
+
+    if (p == PAWN) {
+        int forward = white ? 1 : -1;
+        if ((get_rank(to) == (white ? 7 : 0)) != promotion) return false;
+        if (file_delta != 0) return std::abs(file_delta) == 1 && rank_delta == forward && (enemy & to_bb);
+        if (own & to_bb || enemy & to_bb) return false;
+        if (rank_delta == forward) return true;
+        return rank_delta == 2 * forward && get_rank(from) == (white ? 1 : 6)
+               && !((own | enemy) & square_bb(get_file(from), get_rank(from) + forward));
+    }
+    if (promotion) return false;
+
+    int df = std::abs(file_delta);
+    int dr = std::abs(rank_delta);
+    switch (p) {
+        case KNIGHT:
+            return (df == 1 && dr == 2) || (df == 2 && dr == 1);
+        case KING:
+            return df <= 1 && dr <= 1;
+        case BISHOP:
+            return df == dr && is_path_clear(own | enemy, from, file_delta, rank_delta);
+        case ROOK:
+            return (df == 0 || dr == 0) && is_path_clear(own | enemy, from, file_delta, rank_delta);
+        case QUEEN:
+            return (df == 0 || dr == 0 || df == dr) && is_path_clear(own | enemy, from, file_delta, rank_delta);
+        default:
+            return false;
+    }
+}
+
+bool is_legal(const board& b, move m) {
+    if (!is_pseudo_legal(b, m)) return false;
+    board after = b;
+    after.make_move(m);
+    return !after.under_check(b.side_to_play);
+}
+
+bool is_castling(const board& b, move m) {
+    square from = move_origin(m);
+    return b.piece_at(get_bb(from)) == KING && std::abs(get_file(move_dest(m)) - get_file(from)) == 2;
+}
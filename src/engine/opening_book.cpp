@@ -0,0 +1,187 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <chess/move_gen.h>
+
+#include <chess/engine/opening_book.h>
+#include <chess/engine/move_legality.h>
+
+using namespace chess::core;
+
+// Random64 of the Polyglot book format: 64 squares (a1, b1, ..., h8) for each of black pawn, white pawn, black
+// knight, ..., white king, then the castling rights K, Q, k, q, the en passant files and white to move.
+// polyglot_random64.inc holds the 781 published constants, as in Polyglot's random.cpp, one per line. Without the
+// file the engine builds with books turned off rather than computing keys no book uses.
+#if __has_include("polyglot_random64.inc")
+static constexpr bool HAS_POLYGLOT_KEYS = true;
+static const uint64_t polyglot_random64[781] = {
+#include "polyglot_random64.inc"
+};
+#else
+static constexpr bool HAS_POLYGLOT_KEYS = false;
+static const uint64_t polyglot_random64[781] = {};
+#endif
+static constexpr int POLYGLOT_CASTLING = 768;
+static constexpr int POLYGLOT_EN_PASSANT = 772;
+static constexpr int POLYGLOT_TURN = 780;
+
+static int polyglot_piece(piece p) {
+    switch (p) {
+        case PAWN: return 0;
+        case KNIGHT: return 1;
+        case BISHOP: return 2;
+        case ROOK: return 3;
+        case QUEEN: return 4;
+        default: return 5;
+    }
+}
+
+static uint64_t square_bb(int file, int rank) {
+    return uint64_t(1) << (rank * 8 + file);
+}
+
+static uint64_t read_big_endian(const unsigned char* p, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) value = (value << 8) | p[i];
+    return value;
+}
+
+opening_book::~opening_book() {
+    close();
+}
+
+bool opening_book::has_keys() {
+    return HAS_POLYGLOT_KEYS;
+}
+
+bool opening_book::open(const std::string& path) {
+    close();
+    if (!has_keys()) return false;
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size < ENTRY_SIZE) {
+        ::close(fd);
+        return false;
+    }
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) return false;
+    madvise(p, st.st_size, MADV_RANDOM);
+    data = static_cast<const unsigned char*>(p);
+    mapped_size = st.st_size;
+    entries = mapped_size / ENTRY_SIZE;
+    return true;
+}
+
+void opening_book::close() {
+    if (data != nullptr) munmap(const_cast<unsigned char*>(data), mapped_size);
+    data = nullptr;
+    mapped_size = 0;
+    entries = 0;
+}
+
+uint64_t opening_book::key_at(size_t i) const {
+    return read_big_endian(data + i * ENTRY_SIZE, 8);
+}
+
+uint16_t opening_book::move_at(size_t i) const {
+    return read_big_endian(data + i * ENTRY_SIZE + 8, 2);
+}
+
+uint16_t opening_book::weight_at(size_t i) const {
+    return read_big_endian(data + i * ENTRY_SIZE + 10, 2);
+}
+
+uint64_t opening_book::key(const board& b) {
+    uint64_t key = 0;
+    for (piece p : {PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING}) {
+        for (color c : {WHITE, BLACK}) {
+            int kind = 2 * polyglot_piece(p) + (c == WHITE);
+            uint64_t pieces = uint64_t(b.piece_of_type[p]) & uint64_t(b.piece_of_color[c]);
+            for (; pieces != 0; pieces &= pieces - 1) key ^= polyglot_random64[64 * kind + __builtin_ctzll(pieces)];
+        }
+    }
+    if (b.can_castle_king_side[WHITE]) key ^= polyglot_random64[POLYGLOT_CASTLING];
+    if (b.can_castle_queen_side[WHITE]) key ^= polyglot_random64[POLYGLOT_CASTLING + 1];
+    if (b.can_castle_king_side[BLACK]) key ^= polyglot_random64[POLYGLOT_CASTLING + 2];
+    if (b.can_castle_queen_side[BLACK]) key ^= polyglot_random64[POLYGLOT_CASTLING + 3];
+
+    // unlike the FEN, Polyglot only counts the en passant square when a pawn of the side to move stands next to it
+    if (b.en_passant != SQ_NONE) {
+        int file = get_file(b.en_passant);
+        int pawn_rank = b.side_to_play == WHITE ? 4 : 3;
+        uint64_t own_pawns = uint64_t(b.piece_of_type[PAWN]) & uint64_t(b.piece_of_color[b.side_to_play]);
+        uint64_t beside = (file > 0 ? square_bb(file - 1, pawn_rank) : 0) | (file < 7 ? square_bb(file + 1, pawn_rank) : 0);
+        if (own_pawns & beside) key ^= polyglot_random64[POLYGLOT_EN_PASSANT + file];
+    }
+    if (b.side_to_play == WHITE) key ^= polyglot_random64[POLYGLOT_TURN];
+    return key;
+}
+
+uint16_t opening_book::probe(uint64_t key, bool random) {
+    if (!is_open()) return 0;
+    size_t lo = 0;
+    size_t hi = entries;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (key_at(mid) < key) lo = mid + 1;
+        else hi = mid;
+    }
+    size_t end = lo;
+    uint32_t total_weight = 0;
+    size_t heaviest = lo;
+    for (; end < entries && key_at(end) == key; end++) {
+        total_weight += weight_at(end);
+        if (weight_at(end) > weight_at(heaviest)) heaviest = end;
+    }
+    if (end == lo) return 0;
+    if (!random || total_weight == 0) return move_at(heaviest);
+
+    uint32_t pick = std::uniform_int_distribution<uint32_t>(0, total_weight - 1)(rng);
+    for (size_t i = lo; i < end; i++) {
+        if (pick < weight_at(i)) return move_at(i);
+        pick -= weight_at(i);
+    }
+    return move_at(heaviest);
+}
+
+move opening_book::probe(const board& b, bool random) {
+    uint16_t polyglot_move = probe(key(b), random);
+    if (polyglot_move == 0) return null_move;
+    return to_move(b, polyglot_move);
+}
+
+move opening_book::to_move(const board& b, uint16_t polyglot_move) {
+    int to_file = polyglot_move & 7;
+    int to_rank = (polyglot_move >> 3) & 7;
+    int from_file = (polyglot_move >> 6) & 7;
+    int from_rank = (polyglot_move >> 9) & 7;
+    int promotion = (polyglot_move >> 12) & 7;
+    if (promotion > 4) return null_move;
+
+    // the move is put together from the board and then checked, only castling and en passant are generated
+    square from = square(from_rank * 8 + from_file);
+    piece p = b.piece_at(get_bb(from));
+    if (p == KING && from_file == 4 && from_rank == to_rank && (to_file == 7 || to_file == 0)) {
+        // Polyglot writes castling as the king capturing its own rook
+        to_file = to_file == 7 ? 6 : 2;
+    }
+    square to = square(to_rank * 8 + to_file);
+    if ((p == KING && std::abs(to_file - from_file) == 2) || (p == PAWN && from_file != to_file && to == b.en_passant)) {
+        // their type is up to the move generator, like everywhere else they are found by the squares
+        for (move m : move_gen(b).generate()) {
+            if (move_origin(m) == from && move_dest(m) == to) return m;
+        }
+        return null_move;
+    }
+    special_move type = NORMAL;
+    if (promotion != 0) {
+        static const special_move promotions[] = {PROMOTION_KNIGHT, PROMOTION_BISHOP, PROMOTION_ROOK, PROMOTION_QUEEN};
+        type = promotions[promotion - 1];
+    }
+    move m = get_move(from, to, type);
+    return is_legal(b, m) ? m : null_move;
+}
@@ -0,0 +1,72 @@
+#include <sstream>
+#include <chess/engine/search_stats.h>
+
+void search_stats::clear() {
+    *this = search_stats();
+}
+
+double search_stats::first_move_fail_high_rate() const {
+    if (fail_high == 0) return 0;
+    return double(fail_high_first) / double(fail_high);
+}
+
+double search_stats::branching_factor() const {
+    // ratio between the nodes spent in the last two completed iterations
+    int last = MAX_ITERATIONS - 1;
+    while (last > 0 && iteration_nodes[last] == 0) last--;
+    if (last < 2) return 0;
+    uint64_t last_nodes = iteration_nodes[last] - iteration_nodes[last - 1];
+    uint64_t previous_nodes = iteration_nodes[last - 1] - iteration_nodes[last - 2];
+    if (previous_nodes == 0) return 0;
+    return double(last_nodes) / double(previous_nodes);
+}
+
+void search_stats::print(std::ostream& out) const {
+    out << "info string tt probes " << tt_probes
+        << " hits " << tt_hits
+        << " cutoffs exact " << tt_cutoffs[0]
+        << " alpha " << tt_cutoffs[1]
+        << " beta " << tt_cutoffs[2] << std::endl;
+    out << "info string nullmove tries " << null_move_tries
+        << " cutoffs " << null_move_cutoffs
+        << " futility " << futility_prunes << std::endl;
+    out << "info string singular tests " << singular_tests
+        << " extensions " << singular_extensions
+        << " recapture " << recapture_extensions
+        << " pawnpush " << pawn_push_extensions << std::endl;
+    out << "info string failhigh " << fail_high
+        << " first " << fail_high_first
+        << " rate " << first_move_fail_high_rate()
+        << " ebf " << branching_factor() << std::endl;
+    out << "info string qsearch";
+    for (int i = 0; i < MAX_QDEPTH && qsearch_nodes[i] > 0; i++) out << " " << qsearch_nodes[i];
+    out << std::endl;
+}
+
+std::string search_stats::to_json() const {
+    std::stringstream ss;
+    ss << "{\"tt\":{\"probes\":" << tt_probes
+       << ",\"hits\":" << tt_hits
+       << ",\"cutoffs\":{\"exact\":" << tt_cutoffs[0]
+       << ",\"alpha\":" << tt_cutoffs[1]
+       << ",\"beta\":" << tt_cutoffs[2] << "}}";
+    ss << ",\"null_move\":{\"tries\":" << null_move_tries << ",\"cutoffs\":" << null_move_cutoffs << "}";
+    ss << ",\"futility_prunes\":" << futility_prunes;
+    ss << ",\"extensions\":{\"singular_tests\":" << singular_tests
+       << ",\"singular\":" << singular_extensions
+       << ",\"recapture\":" << recapture_extensions
+       << ",\"pawn_push\":" << pawn_push_extensions << "}";
+    ss << ",\"fail_high\":{\"total\":" << fail_high
+       << ",\"first\":" << fail_high_first
+       << ",\"rate\":" << first_move_fail_high_rate() << "}";
+    ss << ",\"qsearch_nodes\":[";
+    int qdepth = MAX_QDEPTH;
+    while (qdepth > 0 && qsearch_nodes[qdepth - 1] == 0) qdepth--;
+    for (int i = 0; i < qdepth; i++) ss << (i > 0 ? "," : "") << qsearch_nodes[i];
+    ss << "],\"iteration_nodes\":[";
+    int iterations = MAX_ITERATIONS;
+    while (iterations > 1 && iteration_nodes[iterations - 1] == 0) iterations--;
+    for (int i = 1; i < iterations; i++) ss << (i > 1 ? "," : "") << iteration_nodes[i];
+    ss << "],\"branching_factor\":" << branching_factor() << "}";
+    return ss.str();
+}
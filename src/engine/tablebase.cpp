@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <mutex>
+#include <tbprobe.h>
+
+#include <chess/engine/evaluator.h>
+#include <chess/engine/tablebase.h>
+
+using namespace chess::core;
+
+namespace {
+    struct fathom_position {
+        uint64_t white, black, kings, queens, rooks, bishops, knights, pawns;
+        unsigned ep;
+        bool turn;
+    };
+
+    fathom_position to_fathom(const board& b) {
+        fathom_position p{};
+        p.white = uint64_t(b.piece_of_color[WHITE]);
+        p.black = uint64_t(b.piece_of_color[BLACK]);
+        p.kings = uint64_t(b.piece_of_type[KING]);
+        p.queens = uint64_t(b.piece_of_type[QUEEN]);
+        p.rooks = uint64_t(b.piece_of_type[ROOK]);
+        p.bishops = uint64_t(b.piece_of_type[BISHOP]);
+        p.knights = uint64_t(b.piece_of_type[KNIGHT]);
+        p.pawns = uint64_t(b.piece_of_type[PAWN]);
+        // Fathom uses 0 for "no en passant square"
+        p.ep = int(b.en_passant) < 64 ? unsigned(b.en_passant) : 0;
+        p.turn = b.side_to_play == WHITE;
+        return p;
+    }
+
+    unsigned castling_rights(const board& b) {
+        return (b.can_castle_king_side[WHITE] ? TB_CASTLING_K : 0) | (b.can_castle_queen_side[WHITE] ? TB_CASTLING_Q : 0)
+               | (b.can_castle_king_side[BLACK] ? TB_CASTLING_k : 0) | (b.can_castle_queen_side[BLACK] ? TB_CASTLING_q : 0);
+    }
+
+    // tb_probe_root keeps its state in globals
+    std::mutex root_probe_mutex;
+}
+
+bool tablebase::init(const std::string& path) {
+    if (!tb_init(path.c_str())) return false;
+    return TB_LARGEST > 0;
+}
+
+int tablebase::max_pieces() {
+    return int(TB_LARGEST);
+}
+
+int tablebase::piece_count(const board& b) {
+    return __builtin_popcountll(uint64_t(b.piece_of_color[WHITE] | b.piece_of_color[BLACK]));
+}
+
+// WDL values ignore the fifty-move rule and castling, so they only hold right after a capture or pawn move and
+// without castling rights; other positions are left to the search
+bool tablebase::probe_wdl(const board& b, int& wdl) {
+    if (piece_count(b) > max_pieces() || b.half_move_counter != 0 || castling_rights(b) != 0) return false;
+    auto p = to_fathom(b);
+    unsigned result = tb_probe_wdl(p.white, p.black, p.kings, p.queens, p.rooks, p.bishops, p.knights, p.pawns,
+                                   0, 0, p.ep, p.turn);
+    if (result == TB_RESULT_FAILED) return false;
+    wdl = int(result) - int(TB_DRAW);
+    return true;
+}
+
+bool tablebase::filter_root_moves(const board& b, std::vector<move>& moves) {
+    if (piece_count(b) > max_pieces() || castling_rights(b) != 0) return false;
+    auto p = to_fathom(b);
+    unsigned results[TB_MAX_MOVES];
+    unsigned result;
+    {
+        // the DTZ probe takes the fifty-move counter into account, so the root is probed at any counter
+        std::lock_guard<std::mutex> lock(root_probe_mutex);
+        result = tb_probe_root(p.white, p.black, p.kings, p.queens, p.rooks, p.bishops, p.knights, p.pawns,
+                               unsigned(b.half_move_counter), 0, p.ep, p.turn, results);
+    }
+    if (result == TB_RESULT_FAILED || result == TB_RESULT_CHECKMATE || result == TB_RESULT_STALEMATE) return false;
+
+    int best_wdl = -1;
+    for (int i = 0; results[i] != TB_RESULT_FAILED; i++)
+        best_wdl = std::max(best_wdl, int(TB_GET_WDL(results[i])));
+
+    std::vector<std::pair<move, int>> kept;
+    for (int i = 0; results[i] != TB_RESULT_FAILED; i++) {
+        if (int(TB_GET_WDL(results[i])) != best_wdl) continue;
+        unsigned from = TB_GET_FROM(results[i]);
+        unsigned to = TB_GET_TO(results[i]);
+        char promotion = " qrbn"[TB_GET_PROMOTES(results[i])];
+        for (move m : moves) {
+            std::string long_move = to_long_move(m);
+            if (get_rank(move_origin(m)) * 8 + get_file(move_origin(m)) == from
+                && get_rank(move_dest(m)) * 8 + get_file(move_dest(m)) == to
+                && (long_move.size() == 4 ? ' ' : long_move[4]) == promotion) {
+                kept.emplace_back(m, TB_GET_DTZ(results[i]));
+                break;
+            }
+        }
+    }
+    if (kept.empty()) return false;
+
+    // when winning, the quickest way to a zeroing move comes first; otherwise the longest resistance
+    bool winning = best_wdl > int(TB_DRAW);
+    std::stable_sort(kept.begin(), kept.end(), [winning] (auto& a, auto& b) {
+        return winning ? a.second < b.second : a.second > b.second;
+    });
+    moves.clear();
+    for (auto& [m, dtz] : kept) moves.push_back(m);
+    return true;
+}
+
+int tablebase::score(int wdl) {
+    // cursed wins and blessed losses are draws under the fifty-move rule
+    if (wdl > 1) return CERTAIN_VICTORY;
+    if (wdl < -1) return -CERTAIN_VICTORY;
+    return DRAW;
+}
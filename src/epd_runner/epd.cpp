@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <stdexcept>
+#include <chess/move_gen.h>
+#include <chess/engine/move_legality.h>
+
+#include "epd.h"
+
+using namespace chess::core;
+
+static std::string trim(const std::string& s) {
+    auto first = s.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) return "";
+    auto last = s.find_last_not_of(" \t\r\n");
+    return s.substr(first, last - first + 1);
+}
+
+static std::vector<std::string> split_operands(const std::string& s) {
+    std::vector<std::string> ret;
+    std::string current;
+    bool quoted = false;
+    for (char c : s) {
+        if (c == '"') {
+            quoted = !quoted;
+        } else if (std::isspace(static_cast<unsigned char>(c)) && !quoted) {
+            if (!current.empty()) ret.push_back(current);
+            current.clear();
+        } else {
+            current += c;
+        }
+    }
+    if (!current.empty()) ret.push_back(current);
+    return ret;
+}
+
+epd_position parse_epd_line(const std::string& line) {
+    std::istringstream in(line);
+    std::string fields[4];
+    for (auto& field : fields) {
+        if (!(in >> field)) throw std::runtime_error("invalid EPD line: " + line);
+    }
+    epd_position ret;
+    // EPD has no move clocks, the search does not depend on them
+    ret.fen = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3] + " 0 1";
+
+    std::string rest;
+    std::getline(in, rest);
+    std::string operation;
+    bool quoted = false;
+    for (char c : rest + ";") {
+        if (c == '"') quoted = !quoted;
+        if (c != ';' || quoted) {
+            operation += c;
+            continue;
+        }
+        auto tokens = split_operands(trim(operation));
+        operation.clear();
+        if (tokens.empty()) continue;
+        if (tokens[0] == "bm") ret.best_moves.assign(tokens.begin() + 1, tokens.end());
+        else if (tokens[0] == "am") ret.avoid_moves.assign(tokens.begin() + 1, tokens.end());
+        else if (tokens[0] == "id" && tokens.size() > 1) ret.id = tokens[1];
+    }
+    return ret;
+}
+
+static char piece_letter(piece p) {
+    switch (p) {
+        case KNIGHT: return 'N';
+        case BISHOP: return 'B';
+        case ROOK: return 'R';
+        case QUEEN: return 'Q';
+        case KING: return 'K';
+        default: return 0;
+    }
+}
+
+std::string to_san(const board& b, move m) {
+    std::string long_move = to_long_move(m);
+    std::string san;
+    if (is_castling(b, m)) {
+        san = long_move[2] == 'g' ? "O-O" : "O-O-O";
+    } else {
+        piece p = b.piece_at(get_bb(move_origin(m)));
+        bool capture = b.piece_at(get_bb(move_dest(m))) != NO_PIECE || (p == PAWN && move_dest(m) == b.en_passant);
+        if (p == PAWN) {
+            if (capture) san += long_move[0];
+        } else {
+            san += piece_letter(p);
+            // another piece of the same type reaching the same square has to be told apart by file, rank or both
+            bool ambiguous = false;
+            bool same_file = false;
+            bool same_rank = false;
+            for (move other : move_gen(b).generate()) {
+                if (other == m || move_dest(other) != move_dest(m) || b.piece_at(get_bb(move_origin(other))) != p)
+                    continue;
+                std::string other_long = to_long_move(other);
+                ambiguous = true;
+                same_file |= other_long[0] == long_move[0];
+                same_rank |= other_long[1] == long_move[1];
+            }
+            if (ambiguous && (!same_file || same_rank)) san += long_move[0];
+            if (ambiguous && same_file) san += long_move[1];
+        }
+        if (capture) san += 'x';
+        san += long_move.substr(2, 2);
+        if (long_move.size() > 4) {
+            san += '=';
+            san += char(std::toupper(long_move[4]));
+        }
+    }
+
+    board after = b;
+    after.make_move(m);
+    if (after.under_check()) san += move_gen(after).generate().empty() ? '#' : '+';
+    return san;
+}
+
+static std::string normalize_san(const std::string& san) {
+    std::string ret;
+    for (char c : san) {
+        if (c == '0') ret += 'O';
+        else if (std::string("x=+#!?").find(c) == std::string::npos) ret += c;
+    }
+    return ret;
+}
+
+bool matches_san(const board& b, move m, const std::string& san) {
+    return normalize_san(to_san(b, m)) == normalize_san(san);
+}
+
+bool is_solution(const board& b, move m, const epd_position& position) {
+    auto matches = [&] (const std::string& san) { return matches_san(b, m, san); };
+    if (!position.best_moves.empty())
+        return std::any_of(position.best_moves.begin(), position.best_moves.end(), matches);
+    if (!position.avoid_moves.empty())
+        return std::none_of(position.avoid_moves.begin(), position.avoid_moves.end(), matches);
+    return false;
+}
@@ -0,0 +1,32 @@
+#ifndef CHESSENGINE_EPD_H
+#define CHESSENGINE_EPD_H
+
+#include <string>
+#include <vector>
+#include <chess/move.h>
+#include <chess/board.h>
+
+// One EPD record: the four position fields followed by operations such as
+//   r1b1kb1r/3q1ppp/pBp1pn2/8/Np3P2/5B2/PPP3PP/R2Q1RK1 w kq - bm Bxc6; id "WAC.005";
+// Only bm (best moves), am (moves to avoid) and id are used, the other operations are skipped.
+struct epd_position {
+    std::string fen;
+    std::string id;
+    std::vector<std::string> best_moves;
+    std::vector<std::string> avoid_moves;
+};
+
+// throws std::runtime_error if the line does not hold the four position fields
+epd_position parse_epd_line(const std::string& line);
+
+// standard algebraic notation of a legal move, including capture, promotion and check marks
+std::string to_san(const chess::core::board& b, chess::core::move m);
+
+// compares a move against a SAN string as written in test suites, which disagree on "x", "=", "+", "#",
+// annotations and 0-0 for O-O, so all of those are ignored
+bool matches_san(const chess::core::board& b, chess::core::move m, const std::string& san);
+
+// a position is solved when the move is one of the best moves, or when there are none, not one to avoid
+bool is_solution(const chess::core::board& b, chess::core::move m, const epd_position& position);
+
+#endif //CHESSENGINE_EPD_H
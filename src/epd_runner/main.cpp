@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <chess/core.h>
+#include <chess/game.h>
+#include <chess/fen.h>
+#include <chess/engine/engine.h>
+#include <chess/engine/static_evaluator.h>
+#include "epd.h"
+
+using namespace chess::core;
+
+struct runner_options {
+    std::string path;
+    int threads = std::max(1, int(std::thread::hardware_concurrency())); // 0 when it is not known
+    std::chrono::milliseconds time{1000};
+    uint64_t nodes = 0;
+    int depth = 30;
+    size_t hash = 1 << 18;
+};
+
+struct runner_state {
+    std::ifstream in;
+    std::mutex mutex; // guards the input stream, the output and the totals
+    int positions = 0;
+    int solved = 0;
+    double solve_seconds = 0;
+    uint64_t nodes = 0;
+};
+
+runner_options parse_options(int argc, char** argv) {
+    if (argc < 2) throw std::runtime_error("usage: epd_runner <file.epd> [--threads N] [--time ms] [--nodes N] [--depth N] [--hash N]");
+    runner_options options;
+    options.path = argv[1];
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string name = argv[i];
+        std::string value = argv[i + 1];
+        if (name == "--threads") options.threads = std::max(1, std::stoi(value));
+        else if (name == "--time") options.time = std::chrono::milliseconds(std::stoi(value));
+        else if (name == "--nodes") options.nodes = std::stoull(value);
+        else if (name == "--depth") options.depth = std::stoi(value);
+        else if (name == "--hash") options.hash = std::stoul(value);
+        else throw std::runtime_error("unknown option " + name);
+    }
+    return options;
+}
+
+// next position of the suite, false at the end of the file
+bool next_position(runner_state& state, epd_position& position, int& index) {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    std::string line;
+    while (std::getline(state.in, line)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos || line[0] == '#') continue;
+        try {
+            position = parse_epd_line(line);
+        } catch (const std::runtime_error& e) {
+            std::cerr << e.what() << std::endl;
+            continue;
+        }
+        index = ++state.positions;
+        if (position.id.empty()) position.id = "#" + std::to_string(index);
+        return true;
+    }
+    return false;
+}
+
+void solve_positions(const runner_options& options, runner_state& state) {
+    static_evaluator eval;
+    engine eng(eval, options.depth, options.hash);
+    eng.uci_output = false;
+    eng.max_nodes = options.nodes;
+    epd_position position;
+    int index;
+    while (next_position(state, position, index)) {
+        game g(fen::board_from_fen(position.fen));
+        board b = g.states.back().b;
+        eng.new_game();
+
+        // time-to-solution is when the search switched to a solving move for the last time
+        auto start = std::chrono::steady_clock::now();
+        double solved_at = -1;
+        eng.on_iteration = [&] (int depth, move m, int score) {
+            if (!is_solution(b, m, position)) solved_at = -1;
+            else if (solved_at < 0) solved_at = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        };
+        move m = eng.timed_search(g, options.time);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        bool solved = m != null_move && is_solution(b, m, position);
+        // a solution found in the last, unfinished iteration was not reported by on_iteration
+        if (solved && solved_at < 0) solved_at = seconds;
+
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.nodes += eng.searched_nodes();
+        std::cout << position.id << (solved ? " solved " : " failed ")
+                  << (m == null_move ? "(none)" : to_san(b, m));
+        for (auto& san : position.best_moves) std::cout << " bm " << san;
+        for (auto& san : position.avoid_moves) std::cout << " am " << san;
+        if (solved) {
+            state.solved++;
+            state.solve_seconds += solved_at;
+            std::cout << " in " << solved_at << "s";
+        }
+        std::cout << " nodes " << eng.searched_nodes() << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    chess::core::init();
+    runner_options options = parse_options(argc, argv);
+    runner_state state;
+    state.in.open(options.path);
+    if (!state.in) {
+        std::cerr << "could not open " << options.path << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < options.threads; i++)
+        threads.emplace_back(solve_positions, std::cref(options), std::ref(state));
+    for (auto& t : threads) t.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "solved " << state.solved << "/" << state.positions
+              << " mean time-to-solution " << (state.solved > 0 ? state.solve_seconds / state.solved : 0) << "s"
+              << " nodes " << state.nodes
+              << " nps " << uint64_t(state.nodes / std::max(seconds, 1e-3))
+              << " time " << seconds << "s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,48 @@
+#include <iostream>
+#include <string>
+#include <climits>
+#include <unistd.h>
+
+// Starts the fastest chessengine build this CPU can run. The builds are looked up next to the launcher as
+// chessengine-avx2, chessengine-bmi2, chessengine-popcnt and chessengine-x86-64, which is how
+// scripts/build_variants.sh lays them out. With --which the chosen build is printed instead of started.
+
+static const char* variants[] = {"avx2", "bmi2", "popcnt", "x86-64"};
+
+static std::string executable_dir(const char* argv0) {
+    char path[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    std::string self = length > 0 ? std::string(path, length) : std::string(argv0);
+    auto slash = self.rfind('/');
+    return slash == std::string::npos ? "." : self.substr(0, slash);
+}
+
+static bool cpu_supports(const std::string& variant) {
+    __builtin_cpu_init();
+    bool popcnt = __builtin_cpu_supports("popcnt") && __builtin_cpu_supports("sse4.2");
+    bool bmi2 = popcnt && __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2");
+    bool avx2 = bmi2 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    if (variant == "avx2") return avx2;
+    if (variant == "bmi2") return bmi2;
+    if (variant == "popcnt") return popcnt;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    bool which = argc > 1 && std::string(argv[1]) == "--which";
+    std::string dir = executable_dir(argv[0]);
+    for (const char* variant : variants) {
+        if (!cpu_supports(variant)) continue;
+        std::string path = dir + "/chessengine-" + variant;
+        if (access(path.c_str(), X_OK) != 0) continue;
+        if (which) {
+            std::cout << path << std::endl;
+            return 0;
+        }
+        argv[0] = path.data();
+        execv(path.c_str(), argv);
+        std::cerr << "could not start " << path << std::endl;
+    }
+    std::cerr << "no chessengine build for this CPU in " << dir << std::endl;
+    return 1;
+}
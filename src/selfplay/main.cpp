@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include <chess/core.h>
+#include <chess/move_gen.h>
+#include <chess/game.h>
+#include <chess/engine/engine.h>
+#include <chess/engine/static_evaluator.h>
+#include "training_data.h"
+
+using namespace chess::core;
+
+struct selfplay_options {
+    int games = 100;
+    int threads = std::max(1, int(std::thread::hardware_concurrency())); // 0 when it is not known
+    int depth = 6;
+    uint64_t nodes = 0;
+    size_t hash = 1 << 20;
+    int random_plies = 8;
+    int max_plies = 400;
+    std::string output = "selfplay.bin";
+};
+
+struct selfplay_counters {
+    std::atomic<int> next_game = 0;
+    std::atomic<int> games = 0;
+    std::atomic<uint64_t> positions = 0;
+};
+
+selfplay_options parse_options(int argc, char** argv) {
+    selfplay_options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string name = argv[i];
+        std::string value = argv[i + 1];
+        if (name == "--games") options.games = std::stoi(value);
+        else if (name == "--threads") options.threads = std::max(1, std::stoi(value));
+        else if (name == "--depth") options.depth = std::stoi(value);
+        else if (name == "--nodes") options.nodes = std::stoull(value);
+        else if (name == "--hash") options.hash = std::stoul(value);
+        else if (name == "--random-plies") options.random_plies = std::stoi(value);
+        else if (name == "--max-plies") options.max_plies = std::stoi(value);
+        else if (name == "--output") options.output = value;
+        else throw std::runtime_error("unknown option " + name);
+    }
+    return options;
+}
+
+// plays one game and returns its result from white's point of view; the searched positions are appended to records
+int play_game(engine& eng, std::mt19937& rng, const selfplay_options& options,
+              std::vector<std::pair<std::string, int>>& records) {
+    game g;
+    eng.new_game();
+    for (int ply = 0; ply < options.max_plies; ply++) {
+        board b = g.states.back().b;
+        auto moves = move_gen(b).generate();
+        if (moves.empty()) {
+            if (!b.under_check(b.side_to_play)) return 0;
+            return b.side_to_play == WHITE ? -1 : 1;
+        }
+        if (g.is_draw_by_3foldrep() || g.is_draw_by_50move() || g.is_draw_by_insufficient_material()) return 0;
+
+        move m;
+        if (ply < options.random_plies) {
+            // random opening plies keep the games apart; they are not recorded
+            m = moves[std::uniform_int_distribution<size_t>(0, moves.size() - 1)(rng)];
+        } else {
+            auto [best, score] = eng.search_iterate(g);
+            m = best;
+            records.emplace_back(to_fen(b, ply / 2 + 1), score);
+            // a found mate decides the game, there is nothing left to learn from playing it out
+            if (std::abs(score) > MATE - 100) {
+                bool side_wins = score > 0;
+                return (b.side_to_play == WHITE) == side_wins ? 1 : -1;
+            }
+        }
+        g.do_move(m);
+    }
+    return 0;
+}
+
+void play_games(int thread_index, const selfplay_options& options, selfplay_counters& counters, training_writer& writer) {
+    static_evaluator eval;
+    engine eng(eval, options.depth, options.hash);
+    eng.uci_output = false;
+    eng.max_nodes = options.nodes;
+    std::mt19937 rng(std::random_device{}() + thread_index);
+    training_buffer buffer(writer);
+    std::vector<std::pair<std::string, int>> records;
+    while (counters.next_game++ < options.games) {
+        records.clear();
+        int result = play_game(eng, rng, options, records);
+        for (auto& [fen, score] : records) buffer.add(fen, score, result);
+        counters.positions += records.size();
+        counters.games++;
+    }
+}
+
+int main(int argc, char** argv) {
+    using namespace std::chrono_literals;
+    chess::core::init();
+    selfplay_options options = parse_options(argc, argv);
+    training_writer writer(options.output);
+    selfplay_counters counters;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < options.threads; i++)
+        threads.emplace_back(play_games, i, std::cref(options), std::ref(counters), std::ref(writer));
+
+    auto report = [&] () {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "games " << counters.games
+                  << " positions " << counters.positions
+                  << " games/s " << counters.games / seconds
+                  << " positions/s " << counters.positions / seconds << std::endl;
+    };
+    while (counters.games < options.games) {
+        std::this_thread::sleep_for(1s);
+        report();
+    }
+    for (auto& t : threads) t.join();
+    report();
+    return 0;
+}
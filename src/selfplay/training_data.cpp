@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include "training_data.h"
+
+using namespace chess::core;
+
+training_writer::training_writer(const std::string& path) : out(path, std::ios::binary) {
+    if (!out) throw std::runtime_error("could not open " + path);
+    out.write("CETD\x01\0\0\0", 8);
+}
+
+void training_writer::write(const std::string& records) {
+    std::lock_guard<std::mutex> lock(mutex);
+    out.write(records.data(), std::streamsize(records.size()));
+    out.flush();
+}
+
+void training_buffer::add(const std::string& fen, int score, int result) {
+    auto clamped = int16_t(std::clamp(score, -32767, 32767));
+    data.push_back(char(fen.size()));
+    data.append(fen);
+    data.push_back(char(clamped & 0xff));
+    data.push_back(char((clamped >> 8) & 0xff));
+    data.push_back(char(int8_t(result)));
+    if (data.size() >= FLUSH_SIZE) flush();
+}
+
+void training_buffer::flush() {
+    if (data.empty()) return;
+    writer.write(data);
+    data.clear();
+}
+
+std::string to_fen(const board& b, int fullmove_number) {
+    std::stringstream ss;
+    for (int rank = 7; rank >= 0; rank--) {
+        int empty = 0;
+        for (int file = 0; file < 8; file++) {
+            bitboard bb = get_bb(square(rank * 8 + file));
+            piece p = b.piece_at(bb);
+            if (p == NO_PIECE) {
+                empty++;
+                continue;
+            }
+            if (empty > 0) ss << empty;
+            empty = 0;
+            char c = p == PAWN ? 'p' : p == KNIGHT ? 'n' : p == BISHOP ? 'b' : p == ROOK ? 'r' : p == QUEEN ? 'q' : 'k';
+            ss << (b.color_at(bb) == WHITE ? char(std::toupper(c)) : c);
+        }
+        if (empty > 0) ss << empty;
+        if (rank > 0) ss << '/';
+    }
+    ss << (b.side_to_play == WHITE ? " w " : " b ");
+    std::string rights;
+    if (b.can_castle_king_side[WHITE]) rights += 'K';
+    if (b.can_castle_queen_side[WHITE]) rights += 'Q';
+    if (b.can_castle_king_side[BLACK]) rights += 'k';
+    if (b.can_castle_queen_side[BLACK]) rights += 'q';
+    ss << (rights.empty() ? "-" : rights);
+    // only a square on the third or sixth rank is a real en passant target
+    if (int(b.en_passant) < 64 && (get_rank(b.en_passant) == 2 || get_rank(b.en_passant) == 5))
+        ss << ' ' << char('a' + get_file(b.en_passant)) << char('1' + get_rank(b.en_passant));
+    else
+        ss << " -";
+    ss << ' ' << b.half_move_counter << ' ' << fullmove_number;
+    return ss.str();
+}
@@ -0,0 +1,44 @@
+#ifndef CHESSENGINE_TRAINING_DATA_H
+#define CHESSENGINE_TRAINING_DATA_H
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <chess/board.h>
+
+// Training data stream: an 8-byte header "CETD\x01\0\0\0" followed by records of
+//   uint8  length of the FEN
+//   char[] FEN
+//   int16  search score in centipawns, from the side to move's point of view (little-endian)
+//   int8   game result from white's point of view: 1 win, 0 draw, -1 loss
+class training_writer {
+    std::ofstream out;
+    std::mutex mutex;
+
+public:
+    explicit training_writer(const std::string& path);
+
+    void write(const std::string& records);
+};
+
+// per-thread record buffer, handed to the writer in large blocks
+class training_buffer {
+    static constexpr size_t FLUSH_SIZE = 1 << 20;
+    training_writer& writer;
+    std::string data;
+
+public:
+    explicit training_buffer(training_writer& writer) : writer(writer) {}
+
+    ~training_buffer() { flush(); }
+
+    void add(const std::string& fen, int score, int result);
+
+    void flush();
+};
+
+// FEN of the position; the board keeps castling rights and the halfmove clock but not the move number
+std::string to_fen(const chess::core::board& b, int fullmove_number);
+
+#endif //CHESSENGINE_TRAINING_DATA_H
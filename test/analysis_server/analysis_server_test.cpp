@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "analysis_server.h"
+
+using namespace std::chrono_literals;
+
+// a client speaking the server's line protocol
+class client {
+    int fd;
+    std::string input;
+
+public:
+    explicit client(const std::string& path) : fd(socket(AF_UNIX, SOCK_STREAM, 0)) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+        EXPECT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+    }
+
+    ~client() {
+        close(fd);
+    }
+
+    void send(const std::string& line) {
+        std::string data = line + "\n";
+        ASSERT_EQ(::send(fd, data.data(), data.size(), MSG_NOSIGNAL), ssize_t(data.size()));
+    }
+
+    // the next line, or an empty string when none comes within 10 s
+    std::string receive() {
+        size_t end;
+        while ((end = input.find('\n')) == std::string::npos) {
+            pollfd p{fd, POLLIN, 0};
+            if (poll(&p, 1, 10'000) <= 0) return "";
+            char buffer[4096];
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) return "";
+            input.append(buffer, n);
+        }
+        std::string line = input.substr(0, end);
+        input.erase(0, end + 1);
+        return line;
+    }
+};
+
+class analysis_server_test : public testing::Test {
+protected:
+    std::string directory;
+    server_options options;
+    std::atomic<bool> stopping = false;
+    std::unique_ptr<analysis_server> server;
+    std::thread serving;
+
+    void SetUp() override {
+        char name[] = "/tmp/analysis_server_test.XXXXXX";
+        ASSERT_NE(mkdtemp(name), nullptr);
+        directory = name;
+        options.socket_path = directory + "/socket";
+        options.workers = 2;
+        options.hash = 1 << 16;
+        options.depth = 4;
+        server = std::make_unique<analysis_server>(options);
+        serving = std::thread([this] { server->run(stopping); });
+    }
+
+    void TearDown() override {
+        stopping = true;
+        if (serving.joinable()) serving.join();
+        server.reset();
+        rmdir(directory.c_str());
+    }
+};
+
+TEST_F(analysis_server_test, sessions_should_get_their_own_analyses) {
+    client first(options.socket_path);
+    client second(options.socket_path);
+
+    first.send("position startpos moves e2e4");
+    second.send("position fen 6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1");
+    first.send("go depth 3");
+    second.send("go");
+
+    std::string first_result = first.receive();
+    std::string second_result = second.receive();
+    ASSERT_EQ(first_result.rfind("bestmove ", 0), 0) << first_result;
+    ASSERT_NE(first_result.find(" depth 3 "), std::string::npos) << first_result;
+    ASSERT_EQ(second_result.rfind("bestmove d1d8 score mate 1 ", 0), 0) << second_result;
+
+    second.send("isready");
+    ASSERT_EQ(second.receive(), "readyok");
+}
+
+TEST_F(analysis_server_test, malformed_commands_should_be_answered_with_errors) {
+    client c(options.socket_path);
+    for (const char* command : {"position", "position fen", "position fen not-a-fen", "position startpos moves e2e5",
+                                "go movetime soon", "go nodes -1", "go depth 99999999999999999999", "analyse"}) {
+        c.send(command);
+        std::string reply = c.receive();
+        ASSERT_EQ(reply.rfind("error ", 0), 0) << command << ": " << reply;
+    }
+
+    // the server is still up, for this session and for new ones
+    c.send("isready");
+    ASSERT_EQ(c.receive(), "readyok");
+    client other(options.socket_path);
+    other.send("position startpos");
+    other.send("go depth 2");
+    ASSERT_EQ(other.receive().rfind("bestmove ", 0), 0);
+}
+
+TEST_F(analysis_server_test, a_client_not_reading_should_not_hold_up_the_others) {
+    client idle(options.socket_path);
+    // more replies than the socket buffers, none of them read for now
+    std::string burst;
+    for (int i = 0; i < 50000; i++) burst += "isready\n";
+    burst.pop_back();
+    idle.send(burst);
+    idle.send("position startpos");
+    idle.send("go depth 2");
+
+    client c(options.socket_path);
+    c.send("position startpos");
+    c.send("go depth 2");
+    ASSERT_EQ(c.receive().rfind("bestmove ", 0), 0);
+
+    // nothing was lost meanwhile
+    for (int i = 0; i < 50000; i++) ASSERT_EQ(idle.receive(), "readyok") << i;
+    ASSERT_EQ(idle.receive().rfind("bestmove ", 0), 0);
+}
+
+TEST_F(analysis_server_test, server_should_leave_other_files_at_its_path_alone) {
+    std::string path = directory + "/notes.txt";
+    std::ofstream(path) << "keep me";
+    server_options other = options;
+    other.socket_path = path;
+    ASSERT_THROW(analysis_server server(other), std::runtime_error);
+    std::string content;
+    std::getline(std::ifstream(path), content);
+    ASSERT_EQ(content, "keep me");
+
+    // a file put in place of the socket while the server ran survives the server too
+    other.socket_path = directory + "/replaced";
+    {
+        analysis_server server(other);
+        ASSERT_EQ(std::rename(path.c_str(), other.socket_path.c_str()), 0);
+    }
+    std::getline(std::ifstream(other.socket_path), content);
+    ASSERT_EQ(content, "keep me");
+    unlink(other.socket_path.c_str());
+}
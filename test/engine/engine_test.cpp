@@ -7,8 +7,11 @@
 #include <chess/engine/engine.h>
 #include <chess/game.h>
 #include <chess/fen.h>
+#include <chess/move_gen.h>
 #include <chess/engine/static_evaluator.h>
 #include <chrono>
+#include <algorithm>
+#include <thread>
 
 using namespace chess::core;
 
@@ -183,4 +186,193 @@ TEST(engine_test, static_eval_should_be_simmetric) {
     auto b = fen::board_from_fen("kq6/p7/8/7N/8/8/PP6/4K2R w K--- - 0 1");
     static_evaluator e;
     ASSERT_EQ(e.eval(b), -e.eval(b.flip_colors()));
-}
\ No newline at end of file
+}
+
+TEST(engine_test, multipv_should_report_distinct_lines) {
+    board b = fen::board_from_fen("6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - -");
+    static_evaluator eval;
+    engine e(eval, 4);
+    e.multipv = 3;
+
+    auto g = game(b);
+    auto m = e.search_iterate(g);
+
+    ASSERT_EQ(m.first, get_move(SQ_D1, SQ_D8));
+    ASSERT_EQ(e.pv_lines.size(), 3);
+    ASSERT_EQ(e.pv_lines[0].first, get_move(SQ_D1, SQ_D8));
+    ASSERT_NE(e.pv_lines[1].first, e.pv_lines[0].first);
+    ASSERT_NE(e.pv_lines[2].first, e.pv_lines[0].first);
+    ASSERT_NE(e.pv_lines[2].first, e.pv_lines[1].first);
+    ASSERT_GT(e.pv_lines[0].second, e.pv_lines[1].second);
+}
+
+TEST(engine_test, search_moves_should_restrict_root_moves) {
+    board b = fen::board_from_fen("6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - -");
+    static_evaluator eval;
+    engine e(eval, 4);
+    e.search_moves = {get_move(SQ_H2, SQ_H3), get_move(SQ_D1, SQ_D2)};
+
+    auto g = game(b);
+    auto m = e.search_iterate(g);
+
+    ASSERT_TRUE(m.first == get_move(SQ_H2, SQ_H3) || m.first == get_move(SQ_D1, SQ_D2));
+    ASSERT_EQ(e.root_moves.size(), 2);
+    ASSERT_EQ(e.root_moves[0].m, m.first);
+    for (auto& rm : e.root_moves) ASSERT_GT(rm.nodes, 0);
+}
+
+TEST(engine_test, ponder_search_should_wait_for_ponderhit) {
+    using namespace std::chrono_literals;
+    board b;
+    b.set_initial_position();
+    game g(b);
+    static_evaluator eval;
+    engine e(eval, 3);
+
+    e.start_search(g, 50ms, true);
+    std::this_thread::sleep_for(200ms);
+    ASSERT_FALSE(e.time_over);
+    e.ponderhit();
+    auto m = e.wait_search();
+    ASSERT_NE(m, null_move);
+}
+
+TEST(engine_test, stop_should_end_ponder_search) {
+    using namespace std::chrono_literals;
+    board b;
+    b.set_initial_position();
+    game g(b);
+    static_evaluator eval;
+    engine e(eval);
+
+    e.start_search(g, 50ms, true);
+    std::this_thread::sleep_for(200ms);
+    e.stop();
+    auto m = e.wait_search();
+    ASSERT_NE(m, null_move);
+}
+
+TEST(engine_test, engine_should_relate_new_root_to_previous_search) {
+    board b;
+    b.set_initial_position();
+    game g(b);
+    static_evaluator eval;
+    engine e(eval, 3);
+
+    ASSERT_EQ(e.relate_to_previous_root(g), UNRELATED);
+    g.do_move(get_move(SQ_E2, SQ_E4));
+    e.search_iterate(g);
+    ASSERT_EQ(e.relate_to_previous_root(g), SAME_ROOT);
+
+    g.do_move(get_move(SQ_E7, SQ_E5));
+    g.do_move(get_move(SQ_G1, SQ_F3));
+    ASSERT_EQ(e.relate_to_previous_root(g), CONTINUATION);
+    e.search_iterate(g);
+
+    g.undo_last_move();
+    g.do_move(get_move(SQ_B1, SQ_C3));
+    ASSERT_EQ(e.relate_to_previous_root(g), DEVIATION);
+
+    ASSERT_EQ(e.relate_to_previous_root(game(fen::board_from_fen("6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - -"))), UNRELATED);
+    e.new_game();
+    ASSERT_EQ(e.relate_to_previous_root(g), UNRELATED);
+}
+
+TEST(engine_test, node_limited_search_should_be_reproducible) {
+    board b = fen::board_from_fen("r1qr1b2/1R3pkp/3p2pN/ppnPp1Q1/bn2P3/4P2P/PBBP1PP1/5RK1 w - - 0 1");
+    static_evaluator eval;
+    std::vector<std::pair<move, int>> results;
+    std::vector<uint64_t> node_counts;
+    for (int run = 0; run < 2; run++) {
+        engine e(eval, 30, 1 << 16);
+        e.max_nodes = 20'000;
+        auto g = game(b);
+        results.push_back(e.search_iterate(g));
+        node_counts.push_back(e.searched_nodes());
+        ASSERT_LE(e.searched_nodes(), e.max_nodes);
+    }
+    ASSERT_EQ(results[0], results[1]);
+    ASSERT_EQ(node_counts[0], node_counts[1]);
+}
+
+TEST(engine_test, stopped_search_should_return_score_of_last_completed_iteration) {
+    board b = fen::board_from_fen("r1qr1b2/1R3pkp/3p2pN/ppnPp1Q1/bn2P3/4P2P/PBBP1PP1/5RK1 w - - 0 1");
+    static_evaluator eval;
+    for (uint64_t limit : {3'000, 20'000, 50'000}) {
+        engine e(eval, 30, 1 << 16);
+        e.uci_output = false;
+        e.max_nodes = limit;
+        int completed_depth = 0;
+        int completed_score = 0;
+        e.on_iteration = [&] (int depth, move, int val) {
+            completed_depth = depth;
+            completed_score = val;
+        };
+        auto g = game(b);
+        auto result = e.search_iterate(g);
+        ASSERT_GT(completed_depth, 0);
+        ASSERT_EQ(result.second, completed_score) << "node limit " << limit;
+    }
+}
+
+TEST(engine_test, tiny_transposition_table_should_only_produce_legal_moves) {
+    // with a handful of slots nearly every probe hits an entry of another position, and a 16-bit key lets some
+    // of them through as if they were this one
+    const char* fens[] = {
+            "r1qr1b2/1R3pkp/3p2pN/ppnPp1Q1/bn2P3/4P2P/PBBP1PP1/5RK1 w - - 0 1",
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+            "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    };
+    static_evaluator eval;
+    for (size_t tt_size : {1, 3, 17}) {
+        engine e(eval, 3, tt_size);
+        e.uci_output = false;
+        for (auto fen : fens) {
+            game g(fen::board_from_fen(fen));
+            for (int ply = 0; ply < 4; ply++) {
+                auto legal = move_gen(g.states.back().b).generate();
+                if (legal.empty()) break;
+                auto m = e.search_iterate(g).first;
+                ASSERT_NE(std::find(legal.begin(), legal.end(), m), legal.end());
+                g.do_move(m);
+            }
+        }
+    }
+}
+
+TEST(engine_test, engines_sharing_a_transposition_table_should_search_concurrently) {
+    // a small shared table makes the engines overwrite each other's entries all the time
+    const char* fens[] = {
+            "r1qr1b2/1R3pkp/3p2pN/ppnPp1Q1/bn2P3/4P2P/PBBP1PP1/5RK1 w - - 0 1",
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+            "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    };
+    auto shared_tt = std::make_shared<tt_storage>(1024);
+    std::vector<move> moves(std::size(fens));
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < std::size(fens); i++) {
+        threads.emplace_back([&, i] () {
+            static_evaluator eval;
+            engine e(eval, 5, shared_tt);
+            e.uci_output = false;
+            game g(fen::board_from_fen(fens[i]));
+            moves[i] = e.search_iterate(g).first;
+        });
+    }
+    for (auto& t : threads) t.join();
+    for (size_t i = 0; i < std::size(fens); i++) {
+        auto legal = move_gen(fen::board_from_fen(fens[i])).generate();
+        ASSERT_NE(std::find(legal.begin(), legal.end(), moves[i]), legal.end());
+    }
+
+    // what one table stores the others sharing its slots find
+    transposition_table first(shared_tt);
+    transposition_table second(shared_tt);
+    move m = get_move(SQ_E2, SQ_E4);
+    first.save(0x123456789ABCDEFULL, 7, 42, EXACT, m);
+    tt_node node{};
+    ASSERT_TRUE(second.load(0x123456789ABCDEFULL, 7, &node));
+    EXPECT_EQ(node.bestmove, m);
+    EXPECT_EQ(node.value, 42);
+}
@@ -0,0 +1,33 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <chess/engine/move_history.h>
+
+TEST(move_history_test, gravity_updates_should_stay_bounded) {
+    int entry = 0;
+    for (int i = 0; i < 1000; i++) update_history(entry, history_bonus(20));
+    ASSERT_LE(entry, MAX_HISTORY);
+    ASSERT_GT(entry, MAX_HISTORY * 9 / 10);
+
+    int16_t small_entry = 0;
+    for (int i = 0; i < 1000; i++) update_history(small_entry, -history_bonus(20));
+    ASSERT_GE(small_entry, -MAX_HISTORY);
+    ASSERT_LT(small_entry, -MAX_HISTORY * 9 / 10);
+}
+
+TEST(move_history_test, malus_should_outweigh_saturated_bonus) {
+    int entry = 0;
+    for (int i = 0; i < 1000; i++) update_history(entry, history_bonus(10));
+    int saturated = entry;
+    update_history(entry, -history_bonus(10));
+    ASSERT_LT(entry, saturated - history_bonus(10));
+}
+
+TEST(move_history_test, clear_should_reset_counter_moves) {
+    auto history = std::make_unique<move_history>();
+    history->clear();
+    ASSERT_EQ(history->counter_moves[1][5][63], chess::core::null_move);
+    ASSERT_EQ(history->continuation[1][1][5][63][5][63], 0);
+    history->butterfly[0][12][28] = 800;
+    history->age(8);
+    ASSERT_EQ(history->butterfly[0][12][28], 100);
+}
@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chess/square.h>
+#include <chess/fen.h>
+#include <chess/move_gen.h>
+#include <chess/zobrist.h>
+#include <chess/engine/move_legality.h>
+#include <chess/engine/transposition_table.h>
+
+using namespace chess::core;
+
+TEST(move_legality_test, is_legal_should_accept_exactly_the_generated_moves) {
+    const char* fens[] = {
+            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R b KQkq - 0 1",
+            "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+            "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+            "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1",
+            "4k3/8/8/8/8/8/4q3/4K3 w - - 0 1",
+    };
+    for (auto fen : fens) {
+        board b = fen::board_from_fen(fen);
+        auto legal = move_gen(b).generate();
+        for (uint32_t i = 0; i <= 0xFFFF; i++) {
+            move m = move(i);
+            bool generated = std::find(legal.begin(), legal.end(), m) != legal.end();
+            ASSERT_EQ(is_legal(b, m), generated) << fen << " " << to_long_move(m);
+            if (generated) ASSERT_TRUE(is_pseudo_legal(b, m));
+        }
+    }
+}
+
+TEST(move_legality_test, colliding_tt_key_should_hand_out_foreign_move) {
+    board start = fen::board_from_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    board other = fen::board_from_fen("4k3/8/8/8/8/8/8/4K2R b K - 0 1");
+    transposition_table tt(1);
+    move e2e4 = get_move(SQ_E2, SQ_E4);
+    uint64_t hash = zobrist::hash(start);
+    tt.save(hash, 5, 30, EXACT, e2e4);
+
+    // same slot and same upper 16 bits: the table can't tell the positions apart
+    uint64_t colliding = (hash & 0xFFFF000000000000ULL) | 0x1234;
+    tt_node node{};
+    ASSERT_TRUE(tt.load(colliding, 0, &node));
+    ASSERT_EQ(node.bestmove, e2e4);
+    ASSERT_FALSE(is_legal(other, node.bestmove));
+    ASSERT_FALSE(tt.load(hash ^ (uint64_t(1) << 63), 0, &node));
+}
@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <chess/fen.h>
+#include <chess/game.h>
+#include <chess/move_gen.h>
+#include <chess/engine/engine.h>
+#include <chess/engine/opening_book.h>
+#include <chess/engine/static_evaluator.h>
+
+using namespace chess::core;
+
+static void write_big_endian(std::ofstream& out, uint64_t value, int bytes) {
+    for (int i = bytes - 1; i >= 0; i--) out.put(char((value >> (8 * i)) & 0xff));
+}
+
+static uint16_t polyglot_move(int from_file, int from_rank, int to_file, int to_rank) {
+    return to_file | (to_rank << 3) | (from_file << 6) | (from_rank << 9);
+}
+
+static std::string write_book(const std::vector<std::tuple<uint64_t, uint16_t, uint16_t>>& entries) {
+    auto path = std::filesystem::temp_directory_path() / "opening_book_test.bin";
+    std::ofstream out(path, std::ios::binary);
+    for (auto& [key, m, weight] : entries) {
+        write_big_endian(out, key, 8);
+        write_big_endian(out, m, 2);
+        write_big_endian(out, weight, 2);
+        write_big_endian(out, 0, 4);
+    }
+    return path.string();
+}
+
+static board play(const std::string& long_moves) {
+    board b;
+    b.set_initial_position();
+    std::istringstream in(long_moves);
+    for (std::string long_move; in >> long_move;) {
+        auto moves = move_gen(b).generate();
+        auto m = std::find_if(moves.begin(), moves.end(), [&] (move m) { return to_long_move(m) == long_move; });
+        EXPECT_NE(m, moves.end()) << long_move;
+        b.make_move(*m);
+    }
+    return b;
+}
+
+TEST(opening_book_test, key_should_match_polyglot_reference_keys) {
+    if (!opening_book::has_keys()) GTEST_SKIP() << "built without polyglot_random64.inc";
+    // the examples of the Polyglot book format description
+    ASSERT_EQ(opening_book::key(play("")), 0x463b96181691fc9cULL);
+    ASSERT_EQ(opening_book::key(play("e2e4")), 0x823c9b50fd114196ULL);
+    ASSERT_EQ(opening_book::key(play("e2e4 d7d5")), 0x0756b94461c50fb0ULL);
+    ASSERT_EQ(opening_book::key(play("e2e4 d7d5 e4e5")), 0x662fafb965db29d4ULL);
+    ASSERT_EQ(opening_book::key(play("e2e4 d7d5 e4e5 f7f5")), 0x22a48b5a8e47ff78ULL);
+    ASSERT_EQ(opening_book::key(play("e2e4 d7d5 e4e5 f7f5 e1e2")), 0x652a607ca3f242c1ULL);
+    ASSERT_EQ(opening_book::key(play("e2e4 d7d5 e4e5 f7f5 e1e2 e8f7")), 0x00fdd303c946bdd9ULL);
+    ASSERT_EQ(opening_book::key(play("a2a4 b7b5 h2h4 b5b4 c2c4")), 0x3c8123ea7b067637ULL);
+    ASSERT_EQ(opening_book::key(play("a2a4 b7b5 h2h4 b5b4 c2c4 b4c3 a1a3")), 0x5c3f9b829b279560ULL);
+}
+
+TEST(opening_book_test, polyglot_moves_should_be_read_as_engine_moves) {
+    board promotion = fen::board_from_fen("8/1P4k1/8/8/8/8/6K1/8 w - - 0 1");
+    ASSERT_EQ(opening_book::to_move(promotion, polyglot_move(1, 6, 1, 7) | (4 << 12)),
+              get_move(SQ_B7, SQ_B8, PROMOTION_QUEEN));
+    ASSERT_EQ(opening_book::to_move(promotion, polyglot_move(1, 6, 1, 7) | (1 << 12)),
+              get_move(SQ_B7, SQ_B8, PROMOTION_KNIGHT));
+
+    board en_passant = play("e2e4 a7a6 e4e5 d7d5");
+    move capture = opening_book::to_move(en_passant, polyglot_move(4, 4, 3, 5));
+    ASSERT_NE(capture, null_move);
+    ASSERT_EQ(to_long_move(capture), "e5d6");
+
+    // a move of a piece that isn't there, or that the piece can't make, is no move
+    board start = play("");
+    ASSERT_EQ(opening_book::to_move(start, polyglot_move(4, 3, 4, 4)), null_move);
+    ASSERT_EQ(opening_book::to_move(start, polyglot_move(0, 0, 0, 2)), null_move);
+}
+
+TEST(opening_book_test, probe_should_find_weighted_moves_of_position) {
+    if (!opening_book::has_keys()) GTEST_SKIP() << "built without polyglot_random64.inc";
+    board b;
+    b.set_initial_position();
+    uint64_t key = opening_book::key(b);
+    auto path = write_book({
+            {key - 1, polyglot_move(6, 0, 5, 2), 100},
+            {key, polyglot_move(4, 1, 4, 3), 30},
+            {key, polyglot_move(3, 1, 3, 3), 0},
+            {key + 1, polyglot_move(2, 1, 2, 3), 100},
+    });
+
+    opening_book book;
+    ASSERT_TRUE(book.open(path));
+    ASSERT_EQ(book.size(), 4);
+    ASSERT_EQ(book.probe(b, false), get_move(SQ_E2, SQ_E4));
+    for (int i = 0; i < 20; i++) ASSERT_EQ(book.probe(b, true), get_move(SQ_E2, SQ_E4));
+
+    board out_of_book = fen::board_from_fen("6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - -");
+    ASSERT_EQ(book.probe(out_of_book), null_move);
+}
+
+TEST(opening_book_test, castling_should_be_read_as_king_move) {
+    if (!opening_book::has_keys()) GTEST_SKIP() << "built without polyglot_random64.inc";
+    board b = fen::board_from_fen("r3k2r/pppppppp/8/8/8/8/PPPPPPPP/R3K2R w KQkq - 0 1");
+    auto path = write_book({{opening_book::key(b), polyglot_move(4, 0, 7, 0), 1}});
+
+    opening_book book;
+    ASSERT_TRUE(book.open(path));
+    auto m = book.probe(b);
+    ASSERT_NE(m, null_move);
+    ASSERT_EQ(to_long_move(m), "e1g1");
+}
+
+TEST(opening_book_test, engine_should_play_book_move_without_searching) {
+    if (!opening_book::has_keys()) GTEST_SKIP() << "built without polyglot_random64.inc";
+    using namespace std::chrono_literals;
+    board b;
+    b.set_initial_position();
+    auto path = write_book({{opening_book::key(b), polyglot_move(6, 0, 5, 2), 1}});
+
+    static_evaluator eval;
+    engine e(eval);
+    ASSERT_TRUE(e.book.open(path));
+    game g(b);
+    ASSERT_EQ(e.timed_search(g, 10'000ms), get_move(SQ_G1, SQ_F3));
+}
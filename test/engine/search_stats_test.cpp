@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <chess/board.h>
+#include <chess/game.h>
+#include <chess/fen.h>
+#include <chess/engine/engine.h>
+#include <chess/engine/static_evaluator.h>
+
+using namespace chess::core;
+
+// These tests need the counters compiled in: engine_stats_test links them against engine_stats, the engine
+// library built with SEARCH_STATS, and engine_test skips them unless the whole build has SEARCH_STATS=ON.
+
+TEST(search_stats_test, search_stats_should_be_consistent) {
+    if (!search_stats::enabled()) GTEST_SKIP() << "built without SEARCH_STATS";
+    board b;
+    b.set_initial_position();
+    static_evaluator eval;
+    engine e(eval, 5, 1 << 16);
+    e.uci_output = false;
+
+    auto g = game(b);
+    e.search_iterate(g);
+    const search_stats& s = e.stats;
+
+    ASSERT_GT(s.tt_probes, 0);
+    ASSERT_GT(s.tt_hits, 0);
+    ASSERT_LE(s.tt_hits, s.tt_probes);
+    ASSERT_LE(s.tt_cutoffs[EXACT] + s.tt_cutoffs[ALPHA] + s.tt_cutoffs[BETA], s.tt_hits);
+    ASSERT_GT(s.null_move_tries, 0);
+    ASSERT_LE(s.null_move_cutoffs, s.null_move_tries);
+    ASSERT_GT(s.fail_high, 0);
+    ASSERT_LE(s.fail_high_first, s.fail_high);
+    ASSERT_GT(s.first_move_fail_high_rate(), 0.5);
+    ASSERT_GT(s.qsearch_nodes[0], 0);
+
+    // every iteration searches more nodes than the one before it, and no iteration beyond the last is recorded
+    for (int depth = 2; depth <= 5; depth++) ASSERT_GT(s.iteration_nodes[depth], s.iteration_nodes[depth - 1]);
+    ASSERT_EQ(s.iteration_nodes[6], 0);
+    ASSERT_EQ(s.iteration_nodes[5], e.searched_nodes());
+    ASSERT_GT(s.branching_factor(), 1.0);
+
+    std::string json = s.to_json();
+    ASSERT_EQ(json.front(), '{');
+    ASSERT_NE(json.find("\"probes\":" + std::to_string(s.tt_probes)), std::string::npos);
+}
+
+TEST(search_stats_test, search_stats_should_be_cleared_by_a_new_search) {
+    if (!search_stats::enabled()) GTEST_SKIP() << "built without SEARCH_STATS";
+    static_evaluator eval;
+    engine e(eval, 4, 1 << 16);
+    e.uci_output = false;
+    auto g = game(fen::board_from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"));
+    e.search_iterate(g);
+    uint64_t first_probes = e.stats.tt_probes;
+    e.max_depth = 1;
+    e.search_iterate(g);
+    ASSERT_LT(e.stats.tt_probes, first_probes);
+    ASSERT_EQ(e.stats.iteration_nodes[2], 0);
+}
+
+TEST(search_stats_test, extensions_should_fire_and_stay_bounded) {
+    if (!search_stats::enabled()) GTEST_SKIP() << "built without SEARCH_STATS";
+    static_evaluator eval;
+
+    // the passed pawns reach the 7th on some lines, and deep nodes test their TT move for singularity
+    engine pawn_ending(eval, 14, 1 << 16);
+    pawn_ending.uci_output = false;
+    auto g = game(fen::board_from_fen("8/5k2/8/3Pp3/8/8/5K2/8 w - e6 0 1"));
+    pawn_ending.search_iterate(g);
+    const search_stats& s = pawn_ending.stats;
+    ASSERT_GT(s.singular_tests, 0);
+    ASSERT_GT(s.singular_extensions, 0);
+    ASSERT_LE(s.singular_extensions, s.singular_tests);
+    ASSERT_GT(s.pawn_push_extensions, 0);
+    ASSERT_LT(s.pawn_push_extensions, pawn_ending.searched_nodes() / 10);
+
+    // exd4 is taken back pawn for pawn; too shallow for any singular test
+    engine opening(eval, 5, 1 << 16);
+    opening.uci_output = false;
+    g = game(fen::board_from_fen("r1bqkbnr/pppp1ppp/2n5/4p3/3PP3/5N2/PPP2PPP/RNBQKB1R b KQkq d3 0 3"));
+    opening.search_iterate(g);
+    ASSERT_GT(opening.stats.recapture_extensions, 0);
+    ASSERT_LT(opening.stats.recapture_extensions, opening.searched_nodes() / 10);
+    ASSERT_EQ(opening.stats.singular_tests, 0);
+}
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <chess/fen.h>
+#include <chess/game.h>
+#include <chess/move_gen.h>
+#include <chess/engine/engine.h>
+#include <chess/engine/static_evaluator.h>
+#include <chess/engine/tablebase.h>
+
+using namespace chess::core;
+
+class tablebase_test : public testing::Test {
+protected:
+    void SetUp() override {
+        if (tablebase::init(SYZYGY_TEST_PATH)) return;
+        // a CI run without the tables would pass without ever probing
+        if (std::getenv("CI") != nullptr) FAIL() << "no tablebases in " << SYZYGY_TEST_PATH;
+        GTEST_SKIP() << "no tablebases in " << SYZYGY_TEST_PATH;
+    }
+};
+
+TEST_F(tablebase_test, probe_wdl_should_score_simple_endings) {
+    int wdl;
+    ASSERT_TRUE(tablebase::probe_wdl(fen::board_from_fen("8/8/8/4k3/8/8/8/KQ6 w - - 0 1"), wdl));
+    ASSERT_EQ(wdl, 2);
+    ASSERT_TRUE(tablebase::probe_wdl(fen::board_from_fen("8/8/8/4k3/8/8/8/KQ6 b - - 0 1"), wdl));
+    ASSERT_EQ(wdl, -2);
+    ASSERT_TRUE(tablebase::probe_wdl(fen::board_from_fen("8/8/8/4k3/8/8/8/KB6 w - - 0 1"), wdl));
+    ASSERT_EQ(wdl, 0);
+}
+
+TEST_F(tablebase_test, probe_wdl_should_skip_castling_rights_and_running_fifty_move_counter) {
+    int wdl;
+    ASSERT_FALSE(tablebase::probe_wdl(fen::board_from_fen("4k3/8/8/8/8/8/8/4K2R w K - 0 1"), wdl));
+    ASSERT_TRUE(tablebase::probe_wdl(fen::board_from_fen("4k3/8/8/8/8/8/8/4K2R w - - 0 1"), wdl));
+    ASSERT_FALSE(tablebase::probe_wdl(fen::board_from_fen("4k3/8/8/8/8/8/8/4K2R w - - 12 40"), wdl));
+}
+
+TEST_F(tablebase_test, root_filter_should_keep_only_winning_moves) {
+    board b = fen::board_from_fen("8/8/8/8/8/2k5/8/KQ6 w - - 0 1");
+    auto moves = move_gen(b).generate();
+    auto legal_count = moves.size();
+
+    ASSERT_TRUE(tablebase::filter_root_moves(b, moves));
+    ASSERT_FALSE(moves.empty());
+    ASSERT_LT(moves.size(), legal_count);
+    for (move m : moves) {
+        board after = b;
+        after.make_move(m);
+        after.half_move_counter = 0;
+        int wdl;
+        ASSERT_TRUE(tablebase::probe_wdl(after, wdl));
+        ASSERT_EQ(wdl, -2);
+    }
+}
+
+TEST_F(tablebase_test, engine_should_keep_tablebase_win) {
+    // the search probes only after zeroing moves, so the win is found through the capture of the rook
+    board b = fen::board_from_fen("8/8/8/8/8/2k5/8/KQ5r w - - 0 1");
+    static_evaluator eval;
+    engine e(eval, 6);
+
+    auto g = game(b);
+    auto m = e.search_iterate(g);
+
+    ASSERT_GE(m.second, CERTAIN_VICTORY);
+    board after = b;
+    after.make_move(m.first);
+    after.half_move_counter = 0;
+    int wdl;
+    ASSERT_TRUE(tablebase::probe_wdl(after, wdl));
+    ASSERT_EQ(wdl, -2);
+}
@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <stdexcept>
+#include <chess/fen.h>
+#include <chess/move_gen.h>
+#include "epd.h"
+
+using namespace chess::core;
+
+static move find_move(const board& b, const std::string& long_move) {
+    auto moves = move_gen(b).generate();
+    auto m = std::find_if(moves.begin(), moves.end(), [&] (move m) { return to_long_move(m) == long_move; });
+    EXPECT_NE(m, moves.end()) << long_move;
+    return m == moves.end() ? null_move : *m;
+}
+
+static std::string san(const std::string& fen, const std::string& long_move) {
+    board b = fen::board_from_fen(fen);
+    return to_san(b, find_move(b, long_move));
+}
+
+TEST(epd_test, line_should_give_position_and_operations) {
+    auto wac001 = parse_epd_line("2rr3k/pp3pp1/1nnqbN1p/3pN3/2pP4/2P3Q1/PPB4P/R4RK1 w - - bm Qg6; id \"WAC.001\";");
+    ASSERT_EQ(wac001.fen, "2rr3k/pp3pp1/1nnqbN1p/3pN3/2pP4/2P3Q1/PPB4P/R4RK1 w - - 0 1");
+    ASSERT_EQ(wac001.id, "WAC.001");
+    ASSERT_EQ(wac001.best_moves, std::vector<std::string>{"Qg6"});
+    ASSERT_TRUE(wac001.avoid_moves.empty());
+
+    // several moves, a quoted id holding a ";" and operations that are skipped
+    auto line = parse_epd_line("r1b1kb1r/3q1ppp/pBp1pn2/8/Np3P2/5B2/PPP3PP/R2Q1RK1 w kq - "
+                               "bm Bxc6 Nc5; am Qe2; c0 \"sac; then mate\"; id \"WAC 5\";");
+    ASSERT_EQ(line.fen, "r1b1kb1r/3q1ppp/pBp1pn2/8/Np3P2/5B2/PPP3PP/R2Q1RK1 w kq - 0 1");
+    ASSERT_EQ(line.id, "WAC 5");
+    ASSERT_EQ(line.best_moves, (std::vector<std::string>{"Bxc6", "Nc5"}));
+    ASSERT_EQ(line.avoid_moves, std::vector<std::string>{"Qe2"});
+
+    ASSERT_THROW(parse_epd_line("2rr3k/pp3pp1/1nnqbN1p/3pN3/2pP4/2P3Q1/PPB4P/R4RK1 w -"), std::runtime_error);
+}
+
+TEST(epd_test, san_should_tell_apart_pieces_reaching_the_same_square) {
+    ASSERT_EQ(san("2rr3k/pp3pp1/1nnqbN1p/3pN3/2pP4/2P3Q1/PPB4P/R4RK1 w - -", "g3g6"), "Qg6");
+    // by file, then by rank when the file is shared, then by both
+    ASSERT_EQ(san("4k3/8/8/8/8/8/8/1N2KN2 w - -", "b1d2"), "Nbd2");
+    ASSERT_EQ(san("4k3/8/8/8/8/8/8/1N2KN2 w - -", "f1d2"), "Nfd2");
+    ASSERT_EQ(san("4k3/8/8/R7/8/8/8/R3K3 w - -", "a1a3"), "R1a3");
+    ASSERT_EQ(san("4k3/8/8/R7/8/8/8/R3K3 w - -", "a5a3"), "R5a3");
+    ASSERT_EQ(san("4k3/8/8/8/8/Q7/8/Q1Q1K3 w - -", "a1b2"), "Qa1b2");
+    ASSERT_EQ(san("4k3/8/8/8/8/Q7/8/Q1Q1K3 w - -", "c1b2"), "Qcb2");
+    // a piece pinned to the king can't go there, so nothing needs telling apart
+    ASSERT_EQ(san("4k3/4r3/8/8/8/8/4N3/1N2K3 w - -", "b1c3"), "Nc3");
+}
+
+TEST(epd_test, san_should_mark_captures_promotions_and_checks) {
+    ASSERT_EQ(san("4k3/8/8/3pP3/8/8/8/4K3 w - d6", "e5d6"), "exd6");
+    ASSERT_EQ(san("7k/P7/8/8/8/8/8/K7 w - -", "a7a8q"), "a8=Q+");
+    ASSERT_EQ(san("7k/P7/8/8/8/8/8/K7 w - -", "a7a8n"), "a8=N");
+    ASSERT_EQ(san("r6k/1P6/8/8/8/8/8/K7 w - -", "b7a8r"), "bxa8=R+");
+    ASSERT_EQ(san("6k1/5ppp/8/8/8/8/8/R5K1 w - -", "a1a8"), "Ra8#");
+    ASSERT_EQ(san("r3k2r/8/8/8/8/8/8/R3K2R w KQkq -", "e1g1"), "O-O");
+    ASSERT_EQ(san("r3k2r/8/8/8/8/8/8/R3K2R w KQkq -", "e1c1"), "O-O-O");
+    ASSERT_EQ(san("r3k2r/8/8/8/8/8/8/R3K2R b KQkq -", "e8g8"), "O-O");
+}
+
+TEST(epd_test, san_should_match_the_way_suites_write_it) {
+    board b = fen::board_from_fen("r3k2r/8/8/8/8/8/8/R3K2R w KQkq -");
+    move castle = find_move(b, "e1g1");
+    ASSERT_TRUE(matches_san(b, castle, "O-O"));
+    ASSERT_TRUE(matches_san(b, castle, "0-0"));
+    ASSERT_FALSE(matches_san(b, castle, "O-O-O"));
+
+    board wac001 = fen::board_from_fen("2rr3k/pp3pp1/1nnqbN1p/3pN3/2pP4/2P3Q1/PPB4P/R4RK1 w - -");
+    move qg6 = find_move(wac001, "g3g6");
+    ASSERT_TRUE(matches_san(wac001, qg6, "Qg6"));
+    ASSERT_TRUE(matches_san(wac001, qg6, "Qg6!!"));
+    ASSERT_FALSE(matches_san(wac001, qg6, "Qg5"));
+    ASSERT_TRUE(is_solution(wac001, qg6, parse_epd_line("2rr3k/pp3pp1/1nnqbN1p/3pN3/2pP4/2P3Q1/PPB4P/R4RK1 w - - bm Qg6;")));
+    ASSERT_FALSE(is_solution(wac001, qg6, parse_epd_line("2rr3k/pp3pp1/1nnqbN1p/3pN3/2pP4/2P3Q1/PPB4P/R4RK1 w - - am Qg6;")));
+}
@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <chess/fen.h>
+#include <chess/move_gen.h>
+#include "training_data.h"
+
+using namespace chess::core;
+
+static board play(const std::string& long_moves) {
+    board b;
+    b.set_initial_position();
+    std::istringstream in(long_moves);
+    for (std::string long_move; in >> long_move;) {
+        auto moves = move_gen(b).generate();
+        auto m = std::find_if(moves.begin(), moves.end(), [&] (move m) { return to_long_move(m) == long_move; });
+        EXPECT_NE(m, moves.end()) << long_move;
+        b.make_move(*m);
+    }
+    return b;
+}
+
+TEST(training_data_test, fen_should_describe_played_positions) {
+    ASSERT_EQ(to_fen(play(""), 1), "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    ASSERT_EQ(to_fen(play("e2e4"), 1), "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1");
+    // the king move takes white's rights, the knight moves run the clock
+    ASSERT_EQ(to_fen(play("e2e4 e7e5 e1e2 b8c6"), 3), "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/8/PPPPKPPP/RNBQ1BNR w kq - 2 3");
+    // a rook leaving its corner takes only its own side's right
+    ASSERT_EQ(to_fen(play("h2h4 a7a5 h1h3 a8a6"), 3), "1nbqkbnr/1ppppppp/r7/p7/7P/7R/PPPPPPP1/RNBQKBN1 w Qk - 2 3");
+}
+
+TEST(training_data_test, fen_should_survive_a_round_trip) {
+    for (const char* fen : {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+                            "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+                            "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10"}) {
+        std::string written = fen;
+        int fullmove_number = std::stoi(written.substr(written.rfind(' ') + 1));
+        ASSERT_EQ(to_fen(fen::board_from_fen(fen), fullmove_number), written);
+    }
+}
+
+TEST(training_data_test, records_should_follow_the_documented_layout) {
+    auto path = (std::filesystem::temp_directory_path() / "training_data_test.bin").string();
+    const std::string white = "8/8/8/8/8/8/8/K1k5 w - - 0 1";
+    const std::string black = "8/8/8/8/8/8/8/K1k5 b - - 0 1";
+    {
+        training_writer writer(path);
+        training_buffer buffer(writer);
+        buffer.add(white, -300, 1);
+        buffer.add(black, 40000, -1);
+    }
+    std::ifstream in(path, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::filesystem::remove(path);
+
+    std::string expected("CETD\x01\0\0\0", 8);
+    expected += char(white.size());
+    expected += white;
+    expected += "\xd4\xfe\x01"; // -300 little-endian, white won
+    expected += char(black.size());
+    expected += black;
+    expected += "\xff\x7f\xff"; // clamped to 32767, white lost
+    ASSERT_EQ(data, expected);
+}